@@ -1,6 +1,8 @@
 #include <SFML/Graphics.hpp>
 #include <nlohmann/json.hpp>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <bits/stdc++.h>
 #include <unistd.h>
 #include <math.h>
@@ -8,13 +10,766 @@
 
 using json = nlohmann::json;
 
-std::mt19937_64 rng;
+thread_local std::mt19937_64 rng;
+// The stream objects draw from: rng, or a headless field's own stream while that field steps
+thread_local std::mt19937_64* activeRng = &rng;
 std::uniform_real_distribution<double> unif(0, 1);
 
+EventType rollBonus() {
+    if ((float)unif(*activeRng) >= 0.25) return EventType::NO_BONUS;
+    return (EventType)(ceil((float)unif(*activeRng) * 6) + 100);
+}
+
+// Binary saves are little-endian; records are plain 4-byte aligned structs copied with memcpy
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "binary save format assumes a little-endian host");
+
+struct SaveHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sections;
+    uint32_t size;
+    uint32_t crc;
+};
+
+struct DeltaHeader {
+    uint32_t magic;
+    uint32_t base;
+    uint32_t size;
+    uint32_t crc;
+};
+
+struct SaveSection {
+    uint32_t id;
+    uint32_t offset;
+    uint32_t size;
+};
+
+static const std::array<std::string, SaveSectionId::SS_COUNT> sectionNames = {"Settings", "Players", "Gamefield"};
+
+int sectionId(std::string_view name) {
+    for (int i = 0; i < sectionNames.size(); ++i) {
+        if (sectionNames[i] == name) return i;
+    }
+    return -1;
+}
+
+struct SettingsRecord {
+    int32_t difficulty, width, height;
+};
+
+struct StatisticsRecord {
+    int32_t lives, score, catched;
+    float delay;
+    uint32_t nameLength;
+};
+
+struct PlatformRecord {
+    float x, y, width, height, xVelocity, scale;
+};
+
+struct BallRecord {
+    float x, y, radius, xVelocity, yVelocity, scale;
+    uint32_t visible;
+};
+
+struct BonusRecord {
+    float x, y, width, height, yVelocity;
+    int32_t type;
+    uint32_t visible;
+};
+
+struct ObstacleRecord {
+    float x, y, width, height;
+    uint8_t visible, bonus, released, reserved;
+};
+
+struct TimerRecord {
+    int64_t ticksLeft;
+    int32_t event, reserved;
+};
+
+struct GridRecord {
+    int32_t rows, columns;
+    float x, y, pitchX, pitchY, width, height;
+};
+
+// Fixed-size summary kept beside each save slot, so the slots menu reads a few bytes per slot and never the saves themselves
+struct SlotHeader {
+    uint32_t magic;
+    uint16_t version, difficulty;
+    int32_t score, lives;
+    float time;
+    uint32_t thumbnail;
+    char name[32];
+    uint32_t crc;
+};
+
+template <typename T>
+void putRecord(std::string &buf, const T &record) {
+    buf.append((const char*)&record, sizeof(T));
+}
+
+template <typename T>
+T getRecord(const char* &cur) {
+    T record;
+    memcpy(&record, cur, sizeof(T));
+    cur += sizeof(T);
+    return record;
+}
+
+Canvas::Canvas(uint8_t* buffer, int w, int h, int c, sf::Vector2f extent) {
+    pixels = buffer;
+    width = w;
+    height = h;
+    channels = c;
+    scaleX = w / extent.x;
+    scaleY = h / extent.y;
+}
+
+std::pair<int, int> Canvas::span(float from, float to, float scale, int limit) {
+    int first = ceil(from * scale - 0.5f), last = ceil(to * scale - 0.5f);
+    if (last <= first) {
+        first = floor((from + to) / 2 * scale);
+        last = first + 1;
+    }
+    return {std::max(first, 0), std::min(last, limit)};
+}
+
+void Canvas::fillRow(int y, int x0, int x1, sf::Color col) {
+    if (x0 >= x1) return;
+    uint8_t* row = pixels + (size_t)y * width * channels;
+    if (channels == 1) {
+        memset(row + x0, (col.r * 77 + col.g * 150 + col.b * 29) >> 8, x1 - x0);
+        return;
+    }
+    uint8_t rgba[4] = {col.r, col.g, col.b, col.a};
+    for (int x = x0; x < x1; ++x) {
+        memcpy(row + 4 * x, rgba, 4);
+    }
+}
+
+void Canvas::clear(sf::Color col) {
+    fillRow(0, 0, width, col);
+    size_t stride = (size_t)width * channels;
+    for (int y = 1; y < height; ++y) {
+        memcpy(pixels + y * stride, pixels, stride);
+    }
+}
+
+void Canvas::fillRect(sf::FloatRect rect, sf::Color col) {
+    std::pair<int, int> rows = span(rect.top, rect.top + rect.height, scaleY, height);
+    std::pair<int, int> columns = span(rect.left, rect.left + rect.width, scaleX, width);
+    for (int y = rows.first; y < rows.second; ++y) {
+        fillRow(y, columns.first, columns.second, col);
+    }
+}
+
+// Fills the ellipse inscribed in rect, row by row
+void Canvas::fillCircle(sf::FloatRect rect, sf::Color col) {
+    float rx = rect.width / 2, ry = rect.height / 2, cx = rect.left + rx, cy = rect.top + ry;
+    std::pair<int, int> rows = span(rect.top, rect.top + rect.height, scaleY, height);
+    for (int y = rows.first; y < rows.second; ++y) {
+        float dy = std::min(fabs((y + 0.5f) / scaleY - cy) / ry, 1.0f);
+        float half = rx * sqrt(1 - dy * dy);
+        std::pair<int, int> columns = span(cx - half, cx + half, scaleX, width);
+        fillRow(y, columns.first, columns.second, col);
+    }
+}
+
+// Nearest sampling, with half-transparent texels left out the way they would barely show on screen
+void Canvas::blit(sf::FloatRect rect, const sf::Image &image) {
+    sf::Vector2u size = image.getSize();
+    if (!size.x || !size.y) {
+        fillRect(rect, sf::Color::White);
+        return;
+    }
+    const uint8_t* texels = image.getPixelsPtr();
+    std::pair<int, int> rows = span(rect.top, rect.top + rect.height, scaleY, height);
+    std::pair<int, int> columns = span(rect.left, rect.left + rect.width, scaleX, width);
+    for (int y = rows.first; y < rows.second; ++y) {
+        int v = std::clamp((int)(((y + 0.5f) / scaleY - rect.top) / rect.height * size.y), 0, (int)size.y - 1);
+        for (int x = columns.first; x < columns.second; ++x) {
+            int u = std::clamp((int)(((x + 0.5f) / scaleX - rect.left) / rect.width * size.x), 0, (int)size.x - 1);
+            const uint8_t* texel = texels + 4 * ((size_t)v * size.x + u);
+            if (texel[3] < 128) continue;
+            fillRow(y, x, x + 1, sf::Color(texel[0], texel[1], texel[2]));
+        }
+    }
+}
+
+bool Canvas::save(const std::string &filename) {
+    std::string ext = filename.size() > 4 ? filename.substr(filename.size() - 4) : "";
+    if (ext == ".ppm" || ext == ".pgm") {
+        int planes = ext == ".pgm" ? 1 : 3;
+        std::string out = (planes == 1 ? "P5\n" : "P6\n") + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        for (size_t i = 0; i < (size_t)width * height; ++i) {
+            const uint8_t* px = pixels + i * channels;
+            if (channels == 1) {
+                out.append(planes, (char)px[0]);
+            } else if (planes == 1) {
+                out.push_back((char)((px[0] * 77 + px[1] * 150 + px[2] * 29) >> 8));
+            } else {
+                out.append((const char*)px, 3);
+            }
+        }
+        std::ofstream file(filename, std::ios::binary);
+        file.write(out.data(), out.size());
+        return (bool)file;
+    }
+    std::vector<uint8_t> rgba((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            rgba[4 * i + k] = channels == 1 ? (k == 3 ? 255 : pixels[i]) : pixels[4 * i + k];
+        }
+    }
+    sf::Image image;
+    image.create(width, height, rgba.data());
+    return image.saveToFile(filename);
+}
+
+void Canvas::benchmark(int size) {
+    GameField level;
+    Player player("Bench");
+    level.addItem(player.getPlatform());
+    level.addItem(player.getBalls()[0]);
+    level.addLevel();
+    for (int channels : {1, 4}) {
+        std::vector<uint8_t> frame((size_t)size * size * channels);
+        Canvas canvas(frame.data(), size, size, channels);
+        long long frames = 0;
+        sf::Clock clock;
+        while (clock.getElapsedTime().asSeconds() < 1) {
+            for (int k = 0; k < 1000; ++k) {
+                level.rasterize(canvas);
+            }
+            frames += 1000;
+        }
+        float seconds = clock.getElapsedTime().asSeconds();
+        std::cout << size << "x" << size << (channels == 1 ? " gray: " : " RGBA: ") << (long long)(frames / seconds) << " frames per second\n";
+    }
+}
+
+void JsonWriter::prefix() {
+    if (scopes.empty() || !scopes.back().first) return;
+    separate();
+}
+
+void JsonWriter::separate() {
+    if (!scopes.back().second) out += ',';
+    scopes.back().second = false;
+    out += '\n';
+    out.append(scopes.size() * 4, ' ');
+}
+
+void JsonWriter::close(char bracket) {
+    bool wasEmpty = scopes.back().second;
+    scopes.pop_back();
+    if (!wasEmpty) {
+        out += '\n';
+        out.append(scopes.size() * 4, ' ');
+    }
+    out += bracket;
+}
+
+void JsonWriter::beginObject() {
+    prefix();
+    out += '{';
+    scopes.push_back({false, true});
+}
+
+void JsonWriter::endObject() {
+    close('}');
+}
+
+void JsonWriter::beginArray() {
+    prefix();
+    out += '[';
+    scopes.push_back({true, true});
+}
+
+void JsonWriter::endArray() {
+    close(']');
+}
+
+void JsonWriter::key(const char* name) {
+    separate();
+    out += '"';
+    out += name;
+    out += "\": ";
+}
+
+void JsonWriter::value(double num) {
+    prefix();
+    if (!std::isfinite(num)) {
+        out += "null";
+        return;
+    }
+    // Shortest round-trip form; whole numbers keep the trailing .0 saves have always had
+    char buf[64];
+    char* end = std::to_chars(buf, buf + sizeof(buf), num).ptr;
+    out.append(buf, end);
+    if (std::find_if(buf, end, [](char c) { return c == '.' || c == 'e'; }) == end) out += ".0";
+}
+
+void JsonWriter::value(long long num) {
+    prefix();
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), num).ptr);
+}
+
+void JsonWriter::value(bool flag) {
+    prefix();
+    out += flag ? "true" : "false";
+}
+
+void JsonWriter::value(const std::string &str) {
+    prefix();
+    out += '"';
+    for (char c : str) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        case '\r': out += "\\r"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+TextReader::TextReader(const char* data, size_t size) {
+    start = data;
+    cur = data;
+    end = data + size;
+    fileEnd = end;
+}
+
+std::string_view TextReader::token() {
+    if (!failure.empty()) return std::string_view();
+    // Anything up to the space character separates tokens, which keeps this free of locale lookups
+    while (cur < end && (unsigned char)*cur <= ' ') cur++;
+    const char* first = cur;
+    while (cur < end && (unsigned char)*cur > ' ') cur++;
+    last = std::string_view(first, cur - first);
+    return last;
+}
+
+// Lines are only counted once something fails, so reading stays a plain scan
+void TextReader::fail(const std::string &wanted, std::string_view got) {
+    if (!failure.empty()) return;
+    const char* lineStart = got.data();
+    while (lineStart > start && lineStart[-1] != '\n') lineStart--;
+    std::ostringstream out;
+    out << "line " << std::count(start, lineStart, '\n') + 1 << ", column " << got.data() - lineStart + 1 << ": expected " << wanted << ", got ";
+    if (got.empty()) {
+        out << "end of file";
+    } else {
+        out << '\'' << got << '\'';
+    }
+    failure = out.str();
+}
+
+void TextReader::expect(std::string_view label) {
+    std::string_view got = token();
+    if (failure.empty() && got != label) fail("'" + std::string(label) + "'", got);
+}
+
+bool TextReader::peek(std::string_view label) {
+    const char* from = cur;
+    std::string_view before = last;
+    bool found = failure.empty() && token() == label;
+    cur = from;
+    last = before;
+    return found;
+}
+
+// Unindexed saves have no offsets, so passing over a section means reading up to the next one's label
+void TextReader::skipTo(std::string_view label) {
+    while (failure.empty() && !peek(label)) {
+        if (token().empty()) fail("'" + std::string(label) + "'", last);
+    }
+}
+
+// Section offsets in an index count from the first byte after it
+void TextReader::mark() {
+    token();
+    cur -= last.size();
+    body = cur;
+}
+
+bool TextReader::jump(size_t offset, size_t size) {
+    if (!failure.empty() || offset > fileEnd - body || size > fileEnd - body - offset) return false;
+    cur = body + offset;
+    end = cur + size;
+    return true;
+}
+
+std::string_view TextReader::word(std::string_view label) {
+    expect(label);
+    std::string_view got = token();
+    if (failure.empty() && got.empty()) fail("a value for '" + std::string(label) + "'", got);
+    return got;
+}
+
+template<class T> T TextReader::number(std::string_view label) {
+    std::string_view got = word(label);
+    T value{};
+    if (!failure.empty()) return value;
+    std::from_chars_result result = std::from_chars(got.data(), got.data() + got.size(), value);
+    if (result.ec != std::errc() || result.ptr != got.data() + got.size()) fail("a number for '" + std::string(label) + "'", got);
+    return value;
+}
+
+// SAX handler for save.json: fills the binary save records while parsing so no DOM is built,
+// then hands the assembled sections to from_binary
+class JsonLoader : public nlohmann::json_sax<json> {
+private:
+    struct PlayerRecords {
+        StatisticsRecord stats;
+        std::string name;
+        PlatformRecord platform;
+        std::vector<BallRecord> balls;
+    };
+    std::vector<std::pair<std::string, bool>> scopes;
+    std::string lastKey;
+    std::vector<bool> wanted, seen;
+    int section = -1, legacyIndex = 0, version = 0;
+    size_t sectionDepth = 0;
+    bool skip = false;
+    SettingsRecord settings{};
+    std::pair<int, int> space{};
+    std::vector<PlayerRecords> players;
+    BallRecord ball{};
+    BonusRecord bonus{};
+    ObstacleRecord obstacle{};
+    TimerRecord timer{};
+    double timerSeconds = -1;
+    GridRecord grid{};
+    bool hasBonus = false, hasGrid = false;
+    std::vector<TimerRecord> timers;
+    std::vector<std::pair<double, EventType>> legacyTimers;
+    std::string obstacles, cells;
+    uint32_t obstaclesNum = 0;
+
+    const std::string &scope(int depth = 0) {
+        static const std::string none;
+        return scopes.size() > depth ? scopes[scopes.size() - 1 - depth].first : none;
+    }
+
+    void scalar(double num) {
+        if (scopes.size() == 1 && !scopes[0].second && lastKey == "version") version = num;
+        if (skip) return;
+        const std::string &where = scope();
+        if (where == "settings") {
+            if (lastKey == "difficulty") settings.difficulty = num;
+        } else if (where == "resolution") {
+            if (lastKey == "width") settings.width = num;
+            if (lastKey == "height") settings.height = num;
+        } else if (where == "space") {
+            if (lastKey == "width") space.first = num;
+            if (lastKey == "height") space.second = num;
+        } else if (where == "statistics" && !players.empty()) {
+            StatisticsRecord &stats = players.back().stats;
+            if (lastKey == "lives") stats.lives = num;
+            if (lastKey == "score") stats.score = num;
+            if (lastKey == "time") stats.delay = num;
+            if (lastKey == "bonuses_catched") stats.catched = num;
+        } else if (where == "platform" && !players.empty()) {
+            PlatformRecord &platform = players.back().platform;
+            if (lastKey == "x") platform.x = num;
+            if (lastKey == "y") platform.y = num;
+            if (lastKey == "width") platform.width = num;
+            if (lastKey == "height") platform.height = num;
+            if (lastKey == "x_velocity") platform.xVelocity = num;
+            if (lastKey == "scale") platform.scale = num;
+        } else if (where == "ball") {
+            if (lastKey == "x") ball.x = num;
+            if (lastKey == "y") ball.y = num;
+            if (lastKey == "radius") ball.radius = num;
+            if (lastKey == "x_velocity") ball.xVelocity = num;
+            if (lastKey == "y_velocity") ball.yVelocity = num;
+            if (lastKey == "visible") ball.visible = num;
+            if (lastKey == "scale") ball.scale = num;
+        } else if (where == "bonus") {
+            if (lastKey == "type") bonus.type = num;
+            if (lastKey == "x") bonus.x = num;
+            if (lastKey == "y") bonus.y = num;
+            if (lastKey == "width") bonus.width = num;
+            if (lastKey == "height") bonus.height = num;
+            if (lastKey == "y_velocity") bonus.yVelocity = num;
+            if (lastKey == "visible") bonus.visible = num;
+        } else if (where == "obstacle") {
+            if (lastKey == "x") obstacle.x = num;
+            if (lastKey == "y") obstacle.y = num;
+            if (lastKey == "width") obstacle.width = num;
+            if (lastKey == "height") obstacle.height = num;
+            if (lastKey == "visible") obstacle.visible = num;
+        } else if (where == "grid") {
+            if (lastKey == "rows") grid.rows = num;
+            if (lastKey == "columns") grid.columns = num;
+            if (lastKey == "x") grid.x = num;
+            if (lastKey == "y") grid.y = num;
+            if (lastKey == "pitch_x") grid.pitchX = num;
+            if (lastKey == "pitch_y") grid.pitchY = num;
+            if (lastKey == "width") grid.width = num;
+            if (lastKey == "height") grid.height = num;
+        } else if (where.empty() && scope(1) == "timers") {
+            if (lastKey == "ticks_left") timer.ticksLeft = num;
+            if (lastKey == "time_left") timerSeconds = num;
+            if (lastKey == "event") timer.event = num;
+        }
+    }
+
+public:
+    JsonLoader(std::vector<bool> wanted) : wanted(wanted), seen(wanted.size()) {}
+
+    bool null() override { return true; }
+    bool boolean(bool val) override { scalar(val); return true; }
+    bool number_integer(number_integer_t val) override { scalar(val); return true; }
+    bool number_unsigned(number_unsigned_t val) override { scalar(val); return true; }
+    bool number_float(number_float_t val, const string_t &s) override { scalar(val); return true; }
+    bool binary(binary_t &val) override { return true; }
+
+    bool string(string_t &val) override {
+        if (skip) return true;
+        if (scope() == "statistics" && lastKey == "name" && !players.empty()) players.back().name = val;
+        if (scope() == "grid" && lastKey == "cells") {
+            cells.resize(val.size() / 2);
+            for (int i = 0; i < cells.size(); ++i) cells[i] = std::stoi(val.substr(2 * i, 2), nullptr, 16);
+        }
+        return true;
+    }
+
+    bool key(string_t &val) override {
+        lastKey = val;
+        return true;
+    }
+
+    bool start_object(std::size_t elements) override {
+        std::string name = scopes.empty() || scopes.back().second ? "" : lastKey;
+        // Sections are the elements of an unversioned save's array or the members of "sections"
+        bool legacy = scopes.size() == 1 && scopes[0].second;
+        if (legacy || (scopes.size() == 2 && scopes[1].first == "sections")) {
+            section = legacy ? legacyIndex++ : sectionId(name);
+            if (section < 0) section = SaveSectionId::SS_COUNT;
+            sectionDepth = scopes.size();
+            skip = section < 0 || section >= wanted.size() || !wanted[section];
+        }
+        if (name == "player") players.push_back({{3, 0, 0, 0, 0}, "", {0, 0, 0, 0, 0, 1}, {}});
+        if (name == "ball") ball = {0, 0, 0, 0, 0, 1, 1};
+        if (name == "bonus") {
+            bonus = {0, 0, 0, 0, 0, EventType::NO_BONUS, 1};
+            hasBonus = true;
+        }
+        if (name == "obstacle") {
+            obstacle = {0, 0, 0, 0, 1, 0, 0, 0};
+            hasBonus = false;
+        }
+        if (name == "grid" && scope() == "grid") hasGrid = true;
+        if (name.empty() && scope() == "timers") {
+            timer = {0, 0, 0};
+            timerSeconds = -1;
+        }
+        scopes.push_back({name, false});
+        return true;
+    }
+
+    bool end_object() override {
+        std::string name = scope();
+        scopes.pop_back();
+        if (section >= 0 && scopes.size() == sectionDepth) {
+            if (section < seen.size()) seen[section] = true;
+            section = -1;
+            skip = false;
+            return true;
+        }
+        if (skip) return true;
+        if (name == "ball" && !players.empty()) players.back().balls.push_back(ball);
+        if (name == "obstacle") {
+            obstacle.bonus = hasBonus ? bonus.type - EventType::NO_BONUS : 0;
+            obstacle.released = hasBonus && !obstacle.visible;
+            putRecord(obstacles, obstacle);
+            if (obstacle.released) putRecord(obstacles, bonus);
+            obstaclesNum++;
+        }
+        if (name.empty() && scope() == "timers") {
+            if (timerSeconds < 0) {
+                timers.push_back(timer);
+            } else {
+                legacyTimers.push_back({timerSeconds, (EventType)timer.event});
+            }
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t elements) override {
+        scopes.push_back({scopes.empty() || scopes.back().second ? "" : lastKey, true});
+        return true;
+    }
+
+    bool end_array() override {
+        scopes.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string &last_token, const json::exception &ex) override {
+        return false;
+    }
+
+    // Zero when the save records no space
+    std::pair<int, int> getSpace() { return space; }
+    int getVersion() { return version; }
+    // Timers an unversioned save gave in seconds, left out of sections() for Proxy::migrate to convert
+    const std::vector<std::pair<double, EventType>> &getLegacyTimers() { return legacyTimers; }
+
+    bool complete() {
+        for (int i = 0; i < wanted.size(); ++i) {
+            if (wanted[i] && !seen[i]) return false;
+        }
+        return true;
+    }
+
+    std::vector<std::string> sections() {
+        std::vector<std::string> result(3);
+        putRecord(result[0], settings);
+        putRecord(result[1], (uint32_t)players.size());
+        for (PlayerRecords &player : players) {
+            player.stats.nameLength = player.name.size();
+            putRecord(result[1], player.stats);
+            result[1] += player.name;
+            putRecord(result[1], player.platform);
+            putRecord(result[1], (uint32_t)player.balls.size());
+            result[1].append((const char*)player.balls.data(), player.balls.size() * sizeof(BallRecord));
+        }
+        putRecord(result[2], (uint32_t)timers.size());
+        result[2].append((const char*)timers.data(), timers.size() * sizeof(TimerRecord));
+        putRecord(result[2], obstaclesNum);
+        result[2] += obstacles;
+        putRecord(result[2], (uint32_t)hasGrid);
+        if (hasGrid) {
+            putRecord(result[2], grid);
+            cells.resize(grid.rows * grid.columns);
+            result[2] += cells;
+        }
+        return result;
+    }
+};
+
+uint32_t crc32(const char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+// Writes next to the target and renames over it, so a crash leaves either the old or the new save
+bool writeFile(const std::string &filename, const std::string &data) {
+    std::string temp = filename + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) break;
+        done += n;
+    }
+    bool ok = done == data.size() && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok) ok = rename(temp.c_str(), filename.c_str()) == 0;
+    if (!ok) unlink(temp.c_str());
+    return ok;
+}
+
+bool appendFile(const std::string &filename, const std::string &data) {
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, data.data(), data.size()) == (ssize_t)data.size() && fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+}
+
+// The first slot keeps the files single-save versions wrote
+std::string slotName(int slot) {
+    return slot ? "save" + std::to_string(slot) : "save";
+}
+
+// The thumbnail is a hash of which bricks still stand, enough to tell apart two slots of the same level
+std::string slotHeader(Difficulty diff, Players* players, GameField* field) {
+    SlotHeader header;
+    memset(&header, 0, sizeof(SlotHeader));
+    header.magic = SaveFormat::SF_SLOT;
+    header.version = SaveFormat::SF_VERSION;
+    header.difficulty = diff;
+    if (!players->getPlayers().empty()) {
+        Statistics* stats = players->getPlayers()[0]->getStatistics();
+        header.score = stats->getScore();
+        header.lives = stats->getLives();
+        header.time = stats->getTime();
+        strncpy(header.name, stats->getName().c_str(), sizeof(header.name) - 1);
+    }
+    if (field) {
+        std::vector<bool> visible = field->getVisibility();
+        std::string bits((visible.size() + 7) / 8, '\0');
+        for (size_t i = 0; i < visible.size(); ++i) {
+            if (visible[i]) bits[i / 8] |= 1 << (i % 8);
+        }
+        header.thumbnail = crc32(bits.data(), bits.size());
+    }
+    header.crc = crc32((const char*)&header, offsetof(SlotHeader, crc));
+    return std::string((const char*)&header, sizeof(SlotHeader));
+}
+
+// Slots saved before headers existed are summarized from the Settings and Players sections of their image.
+// Images are renamed into place whole, so a preview trusts the size and section checks and skips the crc
+bool readSlotHeader(const std::string &name, SlotHeader &header) {
+    int fd = open((name + ".head").c_str(), O_RDONLY);
+    if (fd >= 0) {
+        bool ok = ::read(fd, &header, sizeof(SlotHeader)) == sizeof(SlotHeader);
+        close(fd);
+        header.name[sizeof(header.name) - 1] = '\0';
+        return ok && header.magic == SaveFormat::SF_SLOT && header.crc == crc32((const char*)&header, offsetof(SlotHeader, crc));
+    }
+    MappedFile file(name + ".bin");
+    Proxy proxy;
+    std::vector <SaveloadObject*> blank = {new Settings(), new Players(), nullptr};
+    std::vector <SaveloadObject*> preview = blank;
+    bool ok = proxy.from_binary(preview, file.getData(), file.getSize(), false);
+    if (ok) {
+        std::string bytes = slotHeader(((Settings*)preview[SaveSectionId::SS_SETTINGS])->getSavedDiff(), (Players*)preview[SaveSectionId::SS_PLAYERS], nullptr);
+        memcpy(&header, bytes.data(), sizeof(SlotHeader));
+    }
+    for (int i = 0; i < blank.size(); ++i) {
+        if (preview[i] != blank[i]) delete preview[i];
+        delete blank[i];
+    }
+    return ok;
+}
+
 void DisplayObject::draw(sf::RenderWindow &target) {
     if (visible) target.draw(*shape);
 }
 
+void DisplayObject::rasterize(Canvas &canvas) {
+    if (isVisible()) canvas.fillRect(getBound(), color);
+}
+
 void DisplayObject::setColor(sf::Color col) {
     shape->setFillColor(col);
     color = col;
@@ -31,27 +786,30 @@ bool DisplayObject::isVisible() {
 void DisplayObject::eventHandler(Event e) {};
 
 void DisplayObject::checkBounds() {
-    int w = Settings::getResolution().first, h = Settings::getResolution().second;
-    if (bounds.left < 0 || bounds.left + bounds.width > w) EventDispatcher::setGameEvent({EventType::VERTICAL_COLLISION, this});
-    if (bounds.top + bounds.height > h) EventDispatcher::setGameEvent({EventType::FALL, this});
+    sf::FloatRect ownBounds = getBound();
+    int w = Resolution::LW, h = Resolution::LH;
+    if (ownBounds.left < 0 || ownBounds.left + ownBounds.width > w) EventDispatcher::setGameEvent({EventType::VERTICAL_COLLISION, this});
+    if (ownBounds.top + ownBounds.height > h) EventDispatcher::setGameEvent({EventType::FALL, this});
 }
 
 void DisplayObject::checkCollision(DisplayObject* obj) {
     if (dynamic_cast<Bonus*>(obj)) return;
-    sf::FloatRect objBounds = obj->getBound();
+    sf::FloatRect ownBounds = getBound(), objBounds = obj->getBound();
     float horizontalIntersect = -1, verticalIntersect = -1;
-    std::vector <std::pair<float, bool> > horI;
-    horI.push_back({bounds.left, 1});
-    horI.push_back({bounds.left + bounds.width, 1});
-    horI.push_back({objBounds.left, 0});
-    horI.push_back({objBounds.left + objBounds.width, 0});
+    std::array <std::pair<float, bool>, 4> horI = {{
+        {ownBounds.left, 1},
+        {ownBounds.left + ownBounds.width, 1},
+        {objBounds.left, 0},
+        {objBounds.left + objBounds.width, 0}
+    }};
     sort(horI.begin(), horI.end());
     if (horI[0].second != horI[1].second) horizontalIntersect = horI[2].first - horI[1].first;
-    std::vector <std::pair<float, bool> > verI;
-    verI.push_back({bounds.top, 1});
-    verI.push_back({bounds.top + bounds.height, 1});
-    verI.push_back({objBounds.top, 0});
-    verI.push_back({objBounds.top + objBounds.height, 0});
+    std::array <std::pair<float, bool>, 4> verI = {{
+        {ownBounds.top, 1},
+        {ownBounds.top + ownBounds.height, 1},
+        {objBounds.top, 0},
+        {objBounds.top + objBounds.height, 0}
+    }};
     sort(verI.begin(), verI.end());
     if (verI[0].second != verI[1].second) verticalIntersect = verI[2].first - verI[1].first;
     if (horizontalIntersect != -1 && verticalIntersect != -1) {
@@ -68,26 +826,145 @@ sf::FloatRect DisplayObject::getBound() {
     return bounds; 
 }
 
+int MotionComponents::add(sf::FloatRect b, sf::Vector2f vel, sf::Vector2f base, float scale, uint8_t f, MovableObject* owner) {
+    bounds.push_back(b);
+    velocity.push_back(vel);
+    base_vel.push_back(base);
+    scale_coef.push_back(scale);
+    flags.push_back(f);
+    owners.push_back(owner);
+    return flags.size() - 1;
+}
+
+void MotionComponents::remove(int slot) {
+    int last = flags.size() - 1;
+    if (slot != last) {
+        bounds[slot] = bounds[last];
+        velocity[slot] = velocity[last];
+        base_vel[slot] = base_vel[last];
+        scale_coef[slot] = scale_coef[last];
+        flags[slot] = flags[last];
+        owners[slot] = owners[last];
+        owners[slot]->id = slot;
+    }
+    bounds.pop_back();
+    velocity.pop_back();
+    base_vel.pop_back();
+    scale_coef.pop_back();
+    flags.pop_back();
+    owners.pop_back();
+}
+
+// After a table was assigned in wholesale, points every owner back at its slot here
+void MotionComponents::claim() {
+    for (int i = 0; i < owners.size(); ++i) {
+        MovableObject* owner = owners[i];
+        if (owner->ownsMotion) delete owner->motion;
+        owner->motion = this;
+        owner->id = i;
+        owner->ownsMotion = false;
+    }
+}
+
+void MotionComponents::clear() {
+    bounds.clear();
+    velocity.clear();
+    base_vel.clear();
+    scale_coef.clear();
+    flags.clear();
+    owners.clear();
+}
+
+void MotionComponents::move() {
+    for (int i = 0; i < flags.size(); ++i) {
+        if ((flags[i] & (MotionFlags::MF_VISIBLE | MotionFlags::MF_STEERED)) != MotionFlags::MF_VISIBLE) continue;
+        bounds[i].left += velocity[i].x;
+        bounds[i].top += velocity[i].y;
+    }
+}
+
+void MovableObject::attach(MotionComponents* store) {
+    if (store == motion) return;
+    int slot = store->add(box(), vel(), baseVel(), scaleCoef(), motion->flags[id], this);
+    if (ownsMotion) {
+        delete motion;
+    } else if (id < motion->owners.size() && motion->owners[id] == this) {
+        motion->remove(id);
+    }
+    motion = store;
+    id = slot;
+    ownsMotion = false;
+}
+
+// Moves this object's state out of a shared store into one of its own, freeing the shared slot
+void MovableObject::detach() {
+    if (ownsMotion) return;
+    MotionComponents* own = new MotionComponents();
+    int slot = own->add(box(), vel(), baseVel(), scaleCoef(), motion->flags[id], this);
+    motion->remove(id);
+    motion = own;
+    id = slot;
+    ownsMotion = true;
+}
+
+void MovableObject::draw(sf::RenderWindow &target) {
+    if (!isVisible()) return;
+    shape->setPosition(box().left, box().top);
+    target.draw(*shape);
+}
+
+void MovableObject::setVisible(bool state) {
+    if (state) {
+        motion->flags[id] |= MotionFlags::MF_VISIBLE;
+    } else {
+        motion->flags[id] &= ~MotionFlags::MF_VISIBLE;
+    }
+}
+
+bool MovableObject::isVisible() {
+    return motion->flags[id] & MotionFlags::MF_VISIBLE;
+}
+
+sf::FloatRect MovableObject::getBound() {
+    return box();
+}
+
+void MovableObject::setPosition(sf::Vector2f pos) {
+    box().left = pos.x;
+    box().top = pos.y;
+}
+
+void MovableObject::scale(float k) {
+    shape->scale(sf::Vector2f(k, 1));
+    box().width *= k;
+}
+
 void MovableObject::move() {
     if (!this->isVisible()) return;
-    shape->move(velocity);
-    bounds = shape->getGlobalBounds();
-    position = shape->getPosition();
+    box().left += vel().x;
+    box().top += vel().y;
 }
 
-void MovableObject::move(sf::Vector2f vel) {
+void MovableObject::move(sf::Vector2f v) {
     if (!this->isVisible()) return;
-    shape->move(vel);
-    bounds = shape->getGlobalBounds();
-    position = shape->getPosition();
+    box().left += v.x;
+    box().top += v.y;
 }
 
-void MovableObject::setVelocity(sf::Vector2f vel) {
-    velocity = vel;
+void MovableObject::setVelocity(sf::Vector2f v) {
+    vel() = v;
 }
 
 sf::Vector2f MovableObject::getVelocity() {
-    return velocity;
+    return vel();
+}
+
+void MovableObject::scaleBound(sf::Vector2f koef) {
+    shape->setPosition(box().left * koef.x, box().top * koef.y);
+    shape->scale(koef);
+    box() = shape->getGlobalBounds();
+    vel() = sf::Vector2f(vel().x * koef.x, vel().y * koef.y);
+    baseVel() = sf::Vector2f(baseVel().x * koef.x, baseVel().y * koef.y);
 }
 
 Statistics::Statistics(int l, int s, int c, std::string n, float d = 0) {
@@ -127,44 +1004,49 @@ void Statistics::to_string(std::stringstream &strStream) {
     strStream << "\t\tStatistics\n" << "\t\t\tLives " << lives << "\n\t\t\tScore " << score << "\n\t\t\tTime " << delay << "\n\t\t\tName " << name << "\n\t\t\tBonusesCatched " << catched << '\n'; 
 }
 
-SaveloadObject* Statistics::from_string(std::stringstream &strStream) {
-    std::string temp, name;
-    int lives, score, catched;
-    float delay;
-    strStream >> temp >> temp >> lives >> temp >> score >> temp >> delay >> temp >> name >> temp >> catched;
+SaveloadObject* Statistics::from_string(TextReader &reader) {
+    reader.expect("Statistics");
+    int lives = reader.number<int>("Lives");
+    int score = reader.number<int>("Score");
+    float delay = reader.number<float>("Time");
+    std::string name(reader.word("Name"));
+    int catched = reader.number<int>("BonusesCatched");
     Statistics* stats = new Statistics(lives, score, catched, name, delay);
     return stats;
 }
 
-json Statistics::to_json() {
-    json seri{};
-    seri["lives"] = lives;
-    seri["score"] = score;
-    seri["time"] = delay;
-    seri["name"] = name;
-    seri["bonuses_catched"] = catched;
-    return seri;
+void Statistics::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("bonuses_catched"); writer.value(catched);
+    writer.key("lives"); writer.value(lives);
+    writer.key("name"); writer.value(name);
+    writer.key("score"); writer.value(score);
+    writer.key("time"); writer.value(delay);
+    writer.endObject();
 }
 
-SaveloadObject* Statistics::from_json(json &deri) {
-    int lives, score, catched;
-    float delay;
-    std::string name;
-    lives = deri["lives"].get<int>();
-    score = deri["score"].get<int>();
-    delay = deri["time"].get<float>();
-    name = deri["name"].get<std::string>();
-    catched = deri["bonuses_catched"].get<int>();
-    Statistics* stats = new Statistics(lives, score, catched, name, delay);
+void Statistics::to_binary(std::string &buf) {
+    putRecord(buf, StatisticsRecord{lives, score, catched, delay, (uint32_t)name.size()});
+    buf.append(name);
+}
+
+SaveloadObject* Statistics::from_binary(const char* &cur) {
+    StatisticsRecord record = getRecord<StatisticsRecord>(cur);
+    std::string name(cur, record.nameLength);
+    cur += record.nameLength;
+    Statistics* stats = new Statistics(record.lives, record.score, record.catched, name, record.delay);
     return stats;
 }
 
 TextBlock::TextBlock(sf::Vector2f size, sf::Vector2f pos, sf::Color col, std::string title) : DisplayObject(size, pos, col) {
-    sf::Font *font = new sf::Font();
-    font->loadFromFile("Roboto-Light.ttf");
+    static sf::Font* font = [] {
+        sf::Font* loaded = new sf::Font();
+        loaded->loadFromFile("Roboto-Light.ttf");
+        return loaded;
+    }();
     text = new sf::Text(title, *font);
     text->setPosition(pos);
-    text->setCharacterSize(floor(float(1) / 30 * Settings::getResolution().second));
+    text->setCharacterSize(floor(float(1) / 30 * Resolution::LH));
 }
 
 void TextBlock::setText(std::string str) {
@@ -177,195 +1059,180 @@ void TextBlock::draw(sf::RenderWindow &target) {
 }
 
 void Platform::eventHandler(Event e) {
-    float platformWidth = Settings::getResolution().first * PlatformSize::PS_MEDIUM / 1000;
-    float platformHeight = Settings::getResolution().second * PlatformSize::PS_HEIGHT / 1000;
+    const PhysicsConstants &physics = Physics::get();
     switch (e.type) {
     case EventType::FALL:
-        shape->setPosition(sf::Vector2f(
-            (Settings::getResolution().first - platformWidth) / 2,
-            Settings::getResolution().second - platformHeight
+        setPosition(sf::Vector2f(
+            (Resolution::LW - physics.platformWidth) / 2,
+            Resolution::LH - physics.platformHeight
         ));
-        move(sf::Vector2f(0, 0));
         break;
     case EventType::VERTICAL_COLLISION:
         if (e.obj != this) return;
-        velocity = -velocity;
-        if (bounds.left < 0) {
-            move(sf::Vector2f(-bounds.left, 0));
+        vel() = -vel();
+        if (box().left < 0) {
+            move(sf::Vector2f(-box().left, 0));
         } else {
-            move(sf::Vector2f(Settings::getResolution().first - bounds.left - bounds.width, 0));
+            move(sf::Vector2f(Resolution::LW - box().left - box().width, 0));
         }
         break;
     }   
 }
 
 void Platform::to_string(std::stringstream &strStream) {
-    strStream << "\t\tPlatform" << "\n\t\t\tX " << bounds.left << "\n\t\t\tY " << bounds.top << "\n\t\t\tWidth " << bounds.width << "\n\t\t\tHeight " << bounds.height << "\n\t\t\tXVelocity " << velocity.x << "\n";
+    strStream << "\t\tPlatform" << "\n\t\t\tX " << box().left << "\n\t\t\tY " << box().top << "\n\t\t\tWidth " << box().width << "\n\t\t\tHeight " << box().height << "\n\t\t\tXVelocity " << vel().x << "\n";
 }
 
-SaveloadObject* Platform::from_string(std::stringstream &strStream) {
-    std::string temp;
-    float x, y, w, h, v;
-    strStream >> temp >> temp >> x >> temp >> y >> temp >> w >> temp >> h >> temp >> v;
+SaveloadObject* Platform::from_string(TextReader &reader) {
+    reader.expect("Platform");
+    float x = reader.number<float>("X");
+    float y = reader.number<float>("Y");
+    float w = reader.number<float>("Width");
+    float h = reader.number<float>("Height");
+    float v = reader.number<float>("XVelocity");
     Platform* platform = new Platform(sf::Vector2f(w, h), sf::Vector2f(x, y), sf::Color::Blue, v);
     return platform;
 }
 
-json Platform::to_json() {
-    json seri{};
-    seri["x"] = bounds.left;
-    seri["y"] = bounds.top;
-    seri["width"] = bounds.width;
-    seri["height"] = bounds.height;
-    seri["x_velocity"] = velocity.x;
-    seri["scale"] = scale_coef;
-    return seri;
+void Platform::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("height"); writer.value(box().height);
+    writer.key("scale"); writer.value(scaleCoef());
+    writer.key("width"); writer.value(box().width);
+    writer.key("x"); writer.value(box().left);
+    writer.key("x_velocity"); writer.value(vel().x);
+    writer.key("y"); writer.value(box().top);
+    writer.endObject();
 }
 
-SaveloadObject* Platform::from_json(json &deri) {
-    float x, y, w, h, v, s;
-    x = deri["x"].get<float>();
-    y = deri["y"].get<float>();
-    w = deri["width"].get<float>();
-    h = deri["height"].get<float>();
-    v = deri["x_velocity"].get<float>();
-    s = deri["scale"].get<float>();
-    Platform* platform = new Platform(sf::Vector2f(w, h), sf::Vector2f(x, y), sf::Color::Blue, v);
-    platform->scaleSpeed(s);
-    platform->setScale();
+void Platform::to_binary(std::string &buf) {
+    putRecord(buf, PlatformRecord{box().left, box().top, box().width, box().height, vel().x, scaleCoef()});
+}
+
+SaveloadObject* Platform::from_binary(const char* &cur) {
+    PlatformRecord record = getRecord<PlatformRecord>(cur);
+    Platform* platform = new Platform(sf::Vector2f(record.width, record.height), sf::Vector2f(record.x, record.y), sf::Color::Blue, record.xVelocity);
+    platform->scaleCoef() = record.scale;
     return platform;
 }
 
-float Platform::getBaseSpeedAbs() {
-    float resolution_coef = (float)(Settings::getResolution().first) / (Resolution::W1);
-    return PlatformSpeed::PSP_MEDIUM * resolution_coef;
+// A ball stays round: the radius follows the height like the ball size does, the position and speed follow both axes
+void Ball::scaleBound(sf::Vector2f koef) {
+    MovableObject::scaleBound(koef);
+    float radius = ((sf::CircleShape*)shape)->getRadius() * koef.y;
+    shape->setScale(1, 1);
+    ((sf::CircleShape*)shape)->setRadius(radius);
+    box() = shape->getGlobalBounds();
 }
 
-int Ball::getBaseSpeedAbs(Difficulty diff) {
-    float resolution_coef = (float)(Settings::getResolution().first * Settings::getResolution().second) / (Resolution::W1 * Resolution::H1);
-    switch (diff) {
-    case (Difficulty::DF_EASY):
-        return ceil(resolution_coef * BallSpeed::BSP_SLOW);
-    case (Difficulty::DF_MEDIUM):
-        return ceil(resolution_coef * BallSpeed::BSP_MEDIUM);
-    case (Difficulty::DF_HARD):
-        return ceil(resolution_coef * BallSpeed::BSP_FAST);
-    case (Difficulty::DF_HM):
-        return ceil(resolution_coef * BallSpeed::BSP_FM);
-    case (Difficulty::DF_ME):
-        return ceil(resolution_coef * BallSpeed::BSP_MS);
-    }
-    return 0;
+void Ball::rasterize(Canvas &canvas) {
+    if (isVisible()) canvas.fillCircle(getBound(), color);
 }
+
 void Ball::eventHandler(Event e) {
     if (e.obj != this) return;
-    float ballSpeed;
-    float ballSize = Settings::getResolution().second * BallSize::BS_MEDIUM / 1000;
-    float platformWidth = Settings::getResolution().first * PlatformSize::PS_MEDIUM / 1000;
-    float platformHeight = Settings::getResolution().second * PlatformSize::PS_HEIGHT / 1000;
-    float platformSpeed = Platform(sf::Vector2f(0, 0)).getBaseSpeedAbs();
+    sf::Vector2f &velocity = vel();
+    const PhysicsConstants &physics = Physics::get();
     switch (e.type) {
     case EventType::FALL:
-        shape->setPosition(sf::Vector2f(
-            (Settings::getResolution().first - 2 * ballSize) / 2,
-            Settings::getResolution().second - platformHeight - 2 * ballSize
+        setPosition(sf::Vector2f(
+            (Resolution::LW - 2 * physics.ballSize) / 2,
+            Resolution::LH - physics.platformHeight - 2 * physics.ballSize
         ));
-        move(sf::Vector2f(0, 0));
         EventDispatcher::setGameEvent({EventType::LIVES_DOWN, nullptr});
         break;
     case EventType::VERTICAL_COLLISION:
         move(-velocity);
-        ballSpeed = getBaseSpeedAbs(Settings::getDiff());
         velocity.y /= fabs(velocity.y);
         velocity.x /= fabs(velocity.x);
         velocity.x = -velocity.x;
-        velocity.y *= ((float)unif(rng) * 0.3 + 0.5) * sqrt(ballSpeed);
-        velocity.x *= sqrt(ballSpeed - velocity.y * velocity.y);
+        velocity.y *= ((float)unif(*activeRng) * 0.3 + 0.5) * physics.ballSpeedRoot;
+        velocity.x *= sqrt(physics.ballSpeed - velocity.y * velocity.y);
         setScale();
         break;
     case EventType::HORIZONTAL_COLLISION:
         move(-velocity);
-        ballSpeed = getBaseSpeedAbs(Settings::getDiff());
         velocity.y /= fabs(velocity.y);
         velocity.y = -velocity.y;
         velocity.x /= fabs(velocity.x);
-        velocity.y *= ((float)unif(rng) * 0.3 + 0.5) * sqrt(ballSpeed);
-        velocity.x *= sqrt(ballSpeed - velocity.y * velocity.y);
+        velocity.y *= ((float)unif(*activeRng) * 0.3 + 0.5) * physics.ballSpeedRoot;
+        velocity.x *= sqrt(physics.ballSpeed - velocity.y * velocity.y);
         setScale();
         break;
     }
 }
 
 void Ball::to_string(std::stringstream &strStream) {
-    strStream << "\t\t\tBall" << "\n\t\t\t\tX " << bounds.left << "\n\t\t\t\tY " << bounds.top << "\n\t\t\t\tRadius " << ((sf::CircleShape*)shape)->getRadius() << "\n\t\t\t\tXVelocity " << velocity.x << "\n\t\t\t\tYVelocity " << velocity.y << "\n\t\t\t\tVisible " << visible << "\n";
+    strStream << "\t\t\tBall" << "\n\t\t\t\tX " << box().left << "\n\t\t\t\tY " << box().top << "\n\t\t\t\tRadius " << ((sf::CircleShape*)shape)->getRadius() << "\n\t\t\t\tXVelocity " << vel().x << "\n\t\t\t\tYVelocity " << vel().y << "\n\t\t\t\tVisible " << isVisible() << "\n";
 }
 
-SaveloadObject* Ball::from_string(std::stringstream &strStream) {
-    std::string temp;
-    float x, y, r, vx, vy, vis;
-    strStream >> temp >> temp >> x >> temp >> y >> temp >> r >> temp >> vx >> temp >> vy >> temp >> vis;
+SaveloadObject* Ball::from_string(TextReader &reader) {
+    reader.expect("Ball");
+    float x = reader.number<float>("X");
+    float y = reader.number<float>("Y");
+    float r = reader.number<float>("Radius");
+    float vx = reader.number<float>("XVelocity");
+    float vy = reader.number<float>("YVelocity");
+    bool vis = reader.number<int>("Visible");
     Ball* ball = new Ball(r, sf::Vector2f(x, y), sf::Color::Cyan, sf::Vector2f(vx, vy));
     ball->setVisible(vis);
     return ball;
 }
 
-json Ball::to_json() {
-    json seri{};
-    seri["ball"]["x"] = bounds.left;
-    seri["ball"]["y"] = bounds.top;
-    seri["ball"]["radius"] = ((sf::CircleShape*)shape)->getRadius();
-    seri["ball"]["x_velocity"] = velocity.x;
-    seri["ball"]["y_velocity"] = velocity.y;
-    seri["ball"]["visible"] = visible;
-    seri["ball"]["scale"] = scale_coef;
-    return seri;
+void Ball::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("ball");
+    writer.beginObject();
+    writer.key("radius"); writer.value(((sf::CircleShape*)shape)->getRadius());
+    writer.key("scale"); writer.value(scaleCoef());
+    writer.key("visible"); writer.value(isVisible());
+    writer.key("x"); writer.value(box().left);
+    writer.key("x_velocity"); writer.value(vel().x);
+    writer.key("y"); writer.value(box().top);
+    writer.key("y_velocity"); writer.value(vel().y);
+    writer.endObject();
+    writer.endObject();
 }
 
-SaveloadObject* Ball::from_json(json &deri) {
-    float x, y, r, vx, vy, vis, s;
-    x = deri["ball"]["x"].get<float>();
-    y = deri["ball"]["y"].get<float>();
-    r = deri["ball"]["radius"].get<float>();
-    vx = deri["ball"]["x_velocity"].get<float>();
-    vy = deri["ball"]["y_velocity"].get<float>();
-    vis = deri["ball"]["visible"].get<float>();
-    s = deri["ball"]["scale"].get<float>();
-    Ball* ball = new Ball(r, sf::Vector2f(x, y), sf::Color::Cyan, sf::Vector2f(vx, vy));
-    ball->setVisible(vis);
-    ball->scaleSpeed(s);
-    ball->setScale();
+void Ball::to_binary(std::string &buf) {
+    putRecord(buf, BallRecord{box().left, box().top, ((sf::CircleShape*)shape)->getRadius(), vel().x, vel().y, scaleCoef(), isVisible()});
+}
+
+SaveloadObject* Ball::from_binary(const char* &cur) {
+    BallRecord record = getRecord<BallRecord>(cur);
+    Ball* ball = new Ball(record.radius, sf::Vector2f(record.x, record.y), sf::Color::Cyan, sf::Vector2f(record.xVelocity, record.yVelocity));
+    ball->setVisible(record.visible);
+    ball->scaleCoef() = record.scale;
     return ball;
 }
 
 std::pair<Ball*, Ball*> Ball::mitosis() { 
     std::pair<Ball*, Ball*> temp;
-    float ballSize = Settings::getResolution().second * BallSize::BS_MEDIUM / 1000;
+    float ballSize = Physics::get().ballSize;
     temp.first = new Ball(
         ballSize,
         sf::Vector2f(
-            bounds.left,
-            bounds.top - ballSize
+            box().left,
+            box().top - ballSize
         ),
         sf::Color::Cyan,
-        sf::Vector2f(velocity.x, -velocity.y)
+        sf::Vector2f(vel().x, -vel().y)
     );
     temp.second = new Ball(
         ballSize,
         sf::Vector2f(
-            bounds.left - ballSize,
-            bounds.top
+            box().left - ballSize,
+            box().top
         ),
         sf::Color::Cyan,
-        sf::Vector2f(-velocity.x, velocity.y)
+        sf::Vector2f(-vel().x, vel().y)
     );
     return temp;
 }
 
 Obstacle::Obstacle(sf::Vector2f size, sf::Vector2f pos, sf::Color col) : DisplayObject(size, pos, col) {
-    if ((float)unif(rng) < 0.25) {
-        bonuses.push_back(new Bonus(size, pos, float(BonusSpeed::BSSP_MEDIUM)));
-        //setColor(sf::Color::Green);
-    }
+    released = nullptr;
+    bonus = rollBonus();
 }
 
 void Obstacle::eventHandler(Event e) {
@@ -375,70 +1242,289 @@ void Obstacle::eventHandler(Event e) {
         visible = false;
         //srand(time(NULL));
         EventDispatcher::setGameEvent({EventType::SCORE_UP, nullptr});
-        if (bonuses.size() != 0) {
-            EventDispatcher::setGameEvent({EventType::BONUS, bonuses[ceil((float)unif(rng) * (int)bonuses.size()) - 1]});
+        if (bonus != EventType::NO_BONUS && !released) {
+            released = new Bonus(sf::Vector2f(bounds.width, bounds.height), sf::Vector2f(bounds.left, bounds.top), Physics::get().bonusSpeed, bonus);
+            EventDispatcher::setGameEvent({EventType::BONUS, released});
         }
         break;
     }
 }
 
 void Obstacle::to_string(std::stringstream &strStream) {
-    strStream << "\tObstacle" << "\n\t\tX " << bounds.left << "\n\t\tY " << bounds.top << "\n\t\tWidth " << bounds.width << "\n\t\tHeight " << bounds.height << "\n\t\tVisible " << visible << "\n\t\tBonusesNum " << bonuses.size() << '\n';
-    for (int i = 0; i < bonuses.size(); ++i) {
-        bonuses[i]->to_string(strStream);
+    strStream << "\tObstacle" << "\n\t\tX " << bounds.left << "\n\t\tY " << bounds.top << "\n\t\tWidth " << bounds.width << "\n\t\tHeight " << bounds.height << "\n\t\tVisible " << visible << "\n\t\tBonusesNum " << (bonus != EventType::NO_BONUS) << '\n';
+    if (released) {
+        released->to_string(strStream);
+    } else if (bonus != EventType::NO_BONUS) {
+        strStream << "\t\tBonus\n\t\t\tType " << bonus << "\n\t\t\tX " << bounds.left << "\n\t\t\tY " << bounds.top << "\n\t\t\tWidth " << bounds.width << "\n\t\t\tHeight " << bounds.height << "\n\t\t\tYVelocity " << Physics::get().bonusSpeed << "\n\t\t\tVisible 1\n";
     }
 }
 
-SaveloadObject* Obstacle::from_string(std::stringstream &strStream) {
-    std::string temp;
-    float x, y, w, h, vis, size;
-    strStream >> temp >> temp >> x >> temp >> y >> temp >> w >> temp >> h >> temp >> vis >> temp >> size;
-    Obstacle* obstacle = new Obstacle(sf::Vector2f(w, h), sf::Vector2f(x, y), sf::Color::Yellow);
-    obstacle->clearBonuses();
-    obstacle->setColor(sf::Color::Yellow);
+SaveloadObject* Obstacle::from_string(TextReader &reader) {
+    reader.expect("Obstacle");
+    float x = reader.number<float>("X");
+    float y = reader.number<float>("Y");
+    float w = reader.number<float>("Width");
+    float h = reader.number<float>("Height");
+    bool vis = reader.number<int>("Visible");
+    int size = reader.number<int>("BonusesNum");
+    ((sf::RectangleShape*)shape)->setSize(sf::Vector2f(w, h));
+    shape->setScale(1, 1);
+    shape->setPosition(x, y);
+    position = sf::Vector2f(x, y);
+    bounds = shape->getGlobalBounds();
+    setColor(sf::Color::Yellow);
+    setBonus(EventType::NO_BONUS);
+    released = nullptr;
     //if (size > 0) obstacle->setColor(sf::Color::Green);
-    for (int i = 0; i < size; ++i) {
-        Bonus* bonus = new Bonus(sf::Vector2f(0, 0), sf::Vector2f(0, 0), 0);
-        bonus = (Bonus*)bonus->from_string(strStream);
-        obstacle->addBonus(bonus);
-    }
-    obstacle->setVisible(vis);
-    return obstacle;
-}
-
-json Obstacle::to_json() {
-    json seri{};
-    seri["obstacle"]["x"] = bounds.left;
-    seri["obstacle"]["y"] = bounds.top;
-    seri["obstacle"]["width"] = bounds.width;
-    seri["obstacle"]["height"] = bounds.height;
-    seri["obstacle"]["visible"] = visible;
-    seri["obstacle"]["bonuses_num"] = bonuses.size();
-    for (int i = 0; i < bonuses.size(); ++i) {
-        seri["obstacle"]["bonuses"][i] = bonuses[i]->to_json();
+    for (int i = 0; i < size && reader.ok(); ++i) {
+        reader.expect("Bonus");
+        int event = reader.number<int>("Type");
+        float bx = reader.number<float>("X");
+        float by = reader.number<float>("Y");
+        float bw = reader.number<float>("Width");
+        float bh = reader.number<float>("Height");
+        float bvel = reader.number<float>("YVelocity");
+        bool bvis = reader.number<int>("Visible");
+        setBonus((EventType)event);
+        if (!vis) {
+            released = new Bonus(sf::Vector2f(bw, bh), sf::Vector2f(bx, by), bvel, (EventType)event);
+            released->setVisible(bvis);
+        }
+    }
+    setVisible(vis);
+    return this;
+}
+
+void Obstacle::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("obstacle");
+    writer.beginObject();
+    if (released) {
+        writer.key("bonuses");
+        writer.beginArray();
+        released->to_json(writer);
+        writer.endArray();
+    } else if (bonus != EventType::NO_BONUS) {
+        writer.key("bonuses");
+        writer.beginArray();
+        writer.beginObject();
+        writer.key("bonus");
+        writer.beginObject();
+        writer.key("height"); writer.value(bounds.height);
+        writer.key("type"); writer.value(bonus);
+        writer.key("visible"); writer.value(true);
+        writer.key("width"); writer.value(bounds.width);
+        writer.key("x"); writer.value(bounds.left);
+        writer.key("y"); writer.value(bounds.top);
+        writer.key("y_velocity"); writer.value(Physics::get().bonusSpeed);
+        writer.endObject();
+        writer.endObject();
+        writer.endArray();
+    }
+    writer.key("bonuses_num"); writer.value(int(bonus != EventType::NO_BONUS));
+    writer.key("height"); writer.value(bounds.height);
+    writer.key("visible"); writer.value(visible);
+    writer.key("width"); writer.value(bounds.width);
+    writer.key("x"); writer.value(bounds.left);
+    writer.key("y"); writer.value(bounds.top);
+    writer.endObject();
+    writer.endObject();
+}
+
+void Obstacle::to_binary(std::string &buf) {
+    putRecord(buf, ObstacleRecord{bounds.left, bounds.top, bounds.width, bounds.height, visible, uint8_t(bonus - EventType::NO_BONUS), released != nullptr, 0});
+    if (released) released->to_binary(buf);
+}
+
+// Hydrates this obstacle rather than allocating a new one, so a load can reuse the bricks already on the field
+SaveloadObject* Obstacle::from_binary(const char* &cur) {
+    ObstacleRecord record = getRecord<ObstacleRecord>(cur);
+    ((sf::RectangleShape*)shape)->setSize(sf::Vector2f(record.width, record.height));
+    shape->setScale(1, 1);
+    shape->setPosition(record.x, record.y);
+    position = sf::Vector2f(record.x, record.y);
+    bounds = shape->getGlobalBounds();
+    setColor(sf::Color::Yellow);
+    setBonus((EventType)(record.bonus + EventType::NO_BONUS));
+    released = nullptr;
+    if (record.released) {
+        Bonus blank(sf::Vector2f(0, 0), sf::Vector2f(0, 0), 0, getBonus());
+        released = (Bonus*)blank.from_binary(cur);
+    }
+    setVisible(record.visible);
+    return this;
+}
+
+// One byte per brick: BC_ALIVE plus the bonus as an offset from EventType 100, geometry is derived from the grid
+BrickGrid::BrickGrid(int r, int c, sf::Vector2f org, sf::Vector2f step, sf::Vector2f brick) : DisplayObject(brick, org, sf::Color::Yellow) {
+    rows = r;
+    columns = c;
+    origin = org;
+    pitch = step;
+    refill();
+}
+
+// Every brick alive again, each with a freshly drawn bonus
+void BrickGrid::refill() {
+    cells.assign(rows * columns, BrickCell::BC_ALIVE);
+    alive = rows * columns;
+    hits.clear();
+    for (uint8_t &cell : cells) {
+        cell |= rollBonus() - EventType::NO_BONUS;
     }
-    return seri;
 }
 
-SaveloadObject* Obstacle::from_json(json &deri) {
-    float x, y, w, h, vis;
-    x = deri["obstacle"]["x"].get<float>();
-    y = deri["obstacle"]["y"].get<float>();
-    w = deri["obstacle"]["width"].get<float>();
-    h = deri["obstacle"]["height"].get<float>();
-    vis = deri["obstacle"]["visible"].get<float>();
-    Obstacle* obstacle = new Obstacle(sf::Vector2f(w, h), sf::Vector2f(x, y), sf::Color::Yellow);
-    obstacle->clearBonuses();
-    obstacle->setColor(sf::Color::Yellow);
-    int size = deri["obstacle"]["bonuses_num"].get<int>();
-    //if (size > 0) obstacle->setColor(sf::Color::Green);
-    for (int i = 0; i < size; ++i) {
-        Bonus* bonus = new Bonus(sf::Vector2f(0, 0), sf::Vector2f(0, 0), 0);
-        bonus = (Bonus*)bonus->from_json(deri["obstacle"]["bonuses"][i]);
-        obstacle->addBonus(bonus);
+sf::FloatRect BrickGrid::getCellBound(int cell) {
+    return sf::FloatRect(origin.x + cell % columns * pitch.x, origin.y + cell / columns * pitch.y, bounds.width, bounds.height);
+}
+
+void BrickGrid::draw(sf::RenderWindow &target) {
+    for (int i = 0; i < cells.size(); ++i) {
+        if (!(cells[i] & BrickCell::BC_ALIVE)) continue;
+        shape->setPosition(sf::Vector2f(origin.x + i % columns * pitch.x, origin.y + i / columns * pitch.y));
+        target.draw(*shape);
+    }
+}
+
+void BrickGrid::rasterize(Canvas &canvas) {
+    for (int i = 0; i < cells.size(); ++i) {
+        if (cells[i] & BrickCell::BC_ALIVE) canvas.fillRect(getCellBound(i), color);
     }
-    obstacle->setVisible(vis);
-    return obstacle;
+}
+
+void BrickGrid::scaleBound(sf::Vector2f koef) {
+    DisplayObject::scaleBound(koef);
+    origin = sf::Vector2f(origin.x * koef.x, origin.y * koef.y);
+    pitch = sf::Vector2f(pitch.x * koef.x, pitch.y * koef.y);
+}
+
+void BrickGrid::checkCollision(DisplayObject* obj) {
+    sf::FloatRect objBounds = obj->getBound();
+    int c0 = std::max(0, (int)floor((objBounds.left - origin.x) / pitch.x));
+    int c1 = std::min(columns - 1, (int)floor((objBounds.left + objBounds.width - origin.x) / pitch.x));
+    int r0 = std::max(0, (int)floor((objBounds.top - origin.y) / pitch.y));
+    int r1 = std::min(rows - 1, (int)floor((objBounds.top + objBounds.height - origin.y) / pitch.y));
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            int cell = r * columns + c;
+            if (!(cells[cell] & BrickCell::BC_ALIVE)) continue;
+            sf::FloatRect cellBounds = getCellBound(cell);
+            float horizontalIntersect = std::min(objBounds.left + objBounds.width, cellBounds.left + cellBounds.width) - std::max(objBounds.left, cellBounds.left);
+            float verticalIntersect = std::min(objBounds.top + objBounds.height, cellBounds.top + cellBounds.height) - std::max(objBounds.top, cellBounds.top);
+            if (horizontalIntersect < 0 || verticalIntersect < 0) continue;
+            if (horizontalIntersect >= verticalIntersect) {
+                EventDispatcher::setGameEvent({EventType::HORIZONTAL_COLLISION, obj});
+            } else {
+                EventDispatcher::setGameEvent({EventType::VERTICAL_COLLISION, obj});
+            }
+            hits.push_back(cell);
+            EventDispatcher::setGameEvent({EventType::COLLISION, this});
+            return;
+        }
+    }
+}
+
+void BrickGrid::eventHandler(Event e) {
+    if (e.obj != this || e.type != EventType::COLLISION) return;
+    for (int cell : hits) {
+        if (!(cells[cell] & BrickCell::BC_ALIVE)) continue;
+        cells[cell] &= ~BrickCell::BC_ALIVE;
+        alive--;
+        EventDispatcher::setGameEvent({EventType::SCORE_UP, nullptr});
+        if (cells[cell] & BrickCell::BC_BONUS) {
+            sf::FloatRect cellBounds = getCellBound(cell);
+            Bonus* bonus = new Bonus(sf::Vector2f(cellBounds.width, cellBounds.height), sf::Vector2f(cellBounds.left, cellBounds.top), Physics::get().bonusSpeed, (EventType)((cells[cell] & BrickCell::BC_BONUS) + 100));
+            EventDispatcher::setGameEvent({EventType::BONUS, bonus});
+        }
+    }
+    hits.clear();
+}
+
+void BrickGrid::toggleCell(int cell) {
+    cells[cell] ^= BrickCell::BC_ALIVE;
+    alive += cells[cell] & BrickCell::BC_ALIVE ? 1 : -1;
+}
+
+std::string BrickGrid::packCells() {
+    static const char hex[] = "0123456789abcdef";
+    std::string packed(cells.size() * 2, '0');
+    for (int i = 0; i < cells.size(); ++i) {
+        packed[2 * i] = hex[cells[i] >> 4];
+        packed[2 * i + 1] = hex[cells[i] & 15];
+    }
+    return packed;
+}
+
+bool BrickGrid::unpackCells(std::string_view packed) {
+    alive = 0;
+    for (int i = 0; i < cells.size() && 2 * i + 1 < packed.size(); ++i) {
+        const char* digits = packed.data() + 2 * i;
+        if (std::from_chars(digits, digits + 2, cells[i], 16).ptr != digits + 2) return false;
+        if (cells[i] & BrickCell::BC_ALIVE) alive++;
+    }
+    return true;
+}
+
+void BrickGrid::to_string(std::stringstream &strStream) {
+    strStream << "\tGrid\n\t\tRows " << rows << "\n\t\tColumns " << columns << "\n\t\tX " << origin.x << "\n\t\tY " << origin.y << "\n\t\tPitchX " << pitch.x << "\n\t\tPitchY " << pitch.y << "\n\t\tWidth " << bounds.width << "\n\t\tHeight " << bounds.height << "\n\t\tCells " << packCells() << '\n';
+}
+
+SaveloadObject* BrickGrid::from_string(TextReader &reader) {
+    reader.expect("Grid");
+    int r = reader.number<int>("Rows");
+    int c = reader.number<int>("Columns");
+    float x = reader.number<float>("X");
+    float y = reader.number<float>("Y");
+    float px = reader.number<float>("PitchX");
+    float py = reader.number<float>("PitchY");
+    float w = reader.number<float>("Width");
+    float h = reader.number<float>("Height");
+    std::string_view packed = reader.word("Cells");
+    if (reader.ok() && (r < 0 || c < 0 || packed.size() != (size_t)r * c * 2)) reader.fail(std::to_string(2 * r * c) + " cell digits", packed);
+    if (!reader.ok()) r = c = 0;
+    BrickGrid* grid = new BrickGrid(r, c, sf::Vector2f(x, y), sf::Vector2f(px, py), sf::Vector2f(w, h));
+    if (!grid->unpackCells(packed)) reader.fail("hex cell digits", packed);
+    return grid;
+}
+
+void BrickGrid::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("grid");
+    writer.beginObject();
+    writer.key("cells"); writer.value(packCells());
+    writer.key("columns"); writer.value(columns);
+    writer.key("height"); writer.value(bounds.height);
+    writer.key("pitch_x"); writer.value(pitch.x);
+    writer.key("pitch_y"); writer.value(pitch.y);
+    writer.key("rows"); writer.value(rows);
+    writer.key("width"); writer.value(bounds.width);
+    writer.key("x"); writer.value(origin.x);
+    writer.key("y"); writer.value(origin.y);
+    writer.endObject();
+    writer.endObject();
+}
+
+void BrickGrid::to_binary(std::string &buf) {
+    putRecord(buf, GridRecord{rows, columns, origin.x, origin.y, pitch.x, pitch.y, bounds.width, bounds.height});
+    buf.append((const char*)cells.data(), cells.size());
+}
+
+SaveloadObject* BrickGrid::from_binary(const char* &cur) {
+    GridRecord record = getRecord<GridRecord>(cur);
+    rows = record.rows;
+    columns = record.columns;
+    origin = sf::Vector2f(record.x, record.y);
+    pitch = sf::Vector2f(record.pitchX, record.pitchY);
+    ((sf::RectangleShape*)shape)->setSize(sf::Vector2f(record.width, record.height));
+    shape->setScale(1, 1);
+    shape->setPosition(origin);
+    position = origin;
+    bounds = shape->getGlobalBounds();
+    cells.assign(cur, cur + rows * columns);
+    cur += cells.size();
+    alive = std::count_if(cells.begin(), cells.end(), [](uint8_t cell) { return cell & BrickCell::BC_ALIVE; });
+    hits.clear();
+    return this;
 }
 
 Button::Button(sf::Vector2f size, sf::Vector2f pos, sf::Color col, std::string title, EventType e) : DisplayObject(size, pos, col) {
@@ -461,7 +1547,7 @@ void Button::draw(sf::RenderWindow &target) {
 }
 
 void Button::sendEvent() {
-    EventDispatcher::setEvent({event, nullptr});
+    EventDispatcher::setEvent({event, this});
 }
 
 void Button::setColor(sf::Color col) {
@@ -470,7 +1556,7 @@ void Button::setColor(sf::Color col) {
 
 StatusBar::StatusBar(sf::Vector2f size, Statistics* stats) : DisplayObject(size, sf::Vector2f(0, 0), sf::Color::Black) {
     menu = new Button(
-        sf::Vector2f(Settings::getResolution().first / 15, Settings::getResolution().second / 20),
+        sf::Vector2f(Resolution::LW / 15, Resolution::LH / 20),
         sf::Vector2f(0, 0),
         sf::Color::Blue,
         "Pause",
@@ -478,14 +1564,14 @@ StatusBar::StatusBar(sf::Vector2f size, Statistics* stats) : DisplayObject(size,
     );
 
     bar.push_back(new TextBlock(
-        sf::Vector2f(Settings::getResolution().first / 15, Settings::getResolution().second / 20),
-        sf::Vector2f(Settings::getResolution().first / 15, 0),
+        sf::Vector2f(Resolution::LW / 15, Resolution::LH / 20),
+        sf::Vector2f(Resolution::LW / 15, 0),
         sf::Color::Black,
         "Lives: " + std::to_string(stats->getLives())
     ));
     bar.push_back(new TextBlock(
-        sf::Vector2f(Settings::getResolution().first / 15, Settings::getResolution().second / 20),
-        sf::Vector2f(Settings::getResolution().first / 15 + (Settings::getResolution().first / 20 + Settings::getResolution().first / 10), 0),
+        sf::Vector2f(Resolution::LW / 15, Resolution::LH / 20),
+        sf::Vector2f(Resolution::LW / 15 + (Resolution::LW / 20 + Resolution::LW / 10), 0),
         sf::Color::Black,
         "Score: " + std::to_string(stats->getScore())
     ));
@@ -493,26 +1579,34 @@ StatusBar::StatusBar(sf::Vector2f size, Statistics* stats) : DisplayObject(size,
     out << std::fixed << std::setprecision(2) << stats->getTime();
     std::string time = out.str();
     bar.push_back(new TextBlock(
-        sf::Vector2f(Settings::getResolution().first / 15, Settings::getResolution().second / 20),
-        sf::Vector2f(Settings::getResolution().first / 15 + (Settings::getResolution().first / 20 + Settings::getResolution().first / 10) * 2, 0),
+        sf::Vector2f(Resolution::LW / 15, Resolution::LH / 20),
+        sf::Vector2f(Resolution::LW / 15 + (Resolution::LW / 20 + Resolution::LW / 10) * 2, 0),
         sf::Color::Black,
         "Time: " + time
     ));
     bar.push_back(new TextBlock(
-        sf::Vector2f(Settings::getResolution().first / 15, Settings::getResolution().second / 20),
-        sf::Vector2f(Settings::getResolution().first / 15 + (Settings::getResolution().first / 20 + Settings::getResolution().first / 10) * 3, 0),
+        sf::Vector2f(Resolution::LW / 15, Resolution::LH / 20),
+        sf::Vector2f(Resolution::LW / 15 + (Resolution::LW / 20 + Resolution::LW / 10) * 3, 0),
         sf::Color::Black,
         "Bonuses Catched: " + std::to_string(stats->getCatched())
     ));
     bar.push_back(new TextBlock(
-        sf::Vector2f(Settings::getResolution().first / 15, Settings::getResolution().second / 20),
-        sf::Vector2f(Settings::getResolution().first / 15 + (Settings::getResolution().first / 20 + Settings::getResolution().first / 10) * 4.5, 0),
+        sf::Vector2f(Resolution::LW / 15, Resolution::LH / 20),
+        sf::Vector2f(Resolution::LW / 15 + (Resolution::LW / 20 + Resolution::LW / 10) * 4.5, 0),
         sf::Color::Black,
         "Name: " + stats->getName()
     ));
 };
 
+StatusBar::~StatusBar() {
+    delete menu;
+    for (TextBlock* block : bar) {
+        delete block;
+    }
+}
+
 void StatusBar::update(Statistics* stats, sf::Vector2i mousePos, bool pressed) {
+    PROFILE_ZONE("StatusBar::update");
     menu->setColor(sf::Color::Blue);
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::Escape)) {
         menu->sendEvent();
@@ -539,20 +1633,37 @@ void StatusBar::draw(sf::RenderWindow &target) {
     }
 }
 
-Menu::Menu(sf::Vector2f size, sf::Color col, std::vector<Button*> buttons, std::string title) : DisplayObject(size, sf::Vector2f((Settings::getResolution().first - size.x) / 2, (Settings::getResolution().second - size.y) / 2), col) {
+// Text is left out of frames
+void StatusBar::rasterize(Canvas &canvas) {
+    canvas.fillRect(getBound(), color);
+    menu->rasterize(canvas);
+}
+
+Menu::Menu(sf::Vector2f size, sf::Color col, std::vector<Button*> buttons, std::string title) : DisplayObject(size, sf::Vector2f((Resolution::LW - size.x) / 2, (Resolution::LH - size.y) / 2), col) {
     items = buttons;
     text = new TextBlock(
-        sf::Vector2f(Settings::getResolution().first / 10, Settings::getResolution().second / 20), 
-        sf::Vector2f((Settings::getResolution().first - Settings::getResolution().first / 10) / 2, Settings::getResolution().second / 20), 
+        sf::Vector2f(Resolution::LW / 10, Resolution::LH / 20), 
+        sf::Vector2f((Resolution::LW - Resolution::LW / 10) / 2, Resolution::LH / 20), 
         sf::Color::Red,
         title
     );
 }
 
+Menu::~Menu() {
+    delete text;
+    for (Button* item : items) {
+        delete item;
+    }
+}
+
 Button* Menu::getButton(int index) {
     return items[index];
 }
 
+void Menu::setTitle(std::string title) {
+    text->setText(title);
+}
+
 void Menu::update(sf::Vector2i mousePos, bool pressed) {
     for (Button* button : items) {
         button->setColor(sf::Color::Blue);
@@ -578,8 +1689,62 @@ void Menu::draw(sf::RenderWindow &target) {
 
 std::pair <Resolution, Resolution> Settings::resolution = {Resolution::W0, Resolution::H0};
 Difficulty Settings::difficulty = Difficulty::DF_MEDIUM;
+int Settings::levelScale = 1;
+PhysicsConstants Physics::constants = Physics::compute(Difficulty::DF_MEDIUM);
+
+// Computed once per difficulty change so hot paths never rebuild shapes or take square roots of constants
+PhysicsConstants Physics::compute(Difficulty diff) {
+    PhysicsConstants table;
+    float resolution_coef = (float)(Resolution::LW * Resolution::LH) / (Resolution::W1 * Resolution::H1);
+    int ballSpeed = 0;
+    switch (diff) {
+    case (Difficulty::DF_EASY):
+        ballSpeed = ceil(resolution_coef * BallSpeed::BSP_SLOW);
+        break;
+    case (Difficulty::DF_MEDIUM):
+        ballSpeed = ceil(resolution_coef * BallSpeed::BSP_MEDIUM);
+        break;
+    case (Difficulty::DF_HARD):
+        ballSpeed = ceil(resolution_coef * BallSpeed::BSP_FAST);
+        break;
+    case (Difficulty::DF_HM):
+        ballSpeed = ceil(resolution_coef * BallSpeed::BSP_FM);
+        break;
+    case (Difficulty::DF_ME):
+        ballSpeed = ceil(resolution_coef * BallSpeed::BSP_MS);
+        break;
+    }
+    table.ballSpeed = ballSpeed;
+    table.ballSpeedRoot = sqrt(ballSpeed);
+    table.ballLaunch = sqrt(ballSpeed / 2.0);
+    table.ballSize = Resolution::LH * BallSize::BS_MEDIUM / 1000;
+    table.platformSpeed = PlatformSpeed::PSP_MEDIUM * ((float)(Resolution::LW) / (Resolution::W1));
+    table.platformWidth = Resolution::LW * PlatformSize::PS_MEDIUM / 1000;
+    table.platformHeight = Resolution::LH * PlatformSize::PS_HEIGHT / 1000;
+    table.bonusSpeed = BonusSpeed::BSSP_MEDIUM;
+    table.ballFasten = Coefficients::BALL_COEF * 1.3333;
+    table.ballFastenInverse = (float)1 / (Coefficients::BALL_COEF * 1.3333);
+    table.ballSlowen = Coefficients::BALL_COEF * 1.5;
+    table.ballSlowenInverse = (float)1 / (Coefficients::BALL_COEF * 1.5);
+    table.platformFasten = Coefficients::PLATFORM_COEF * 1.5;
+    table.platformFastenInverse = (float)1 / (Coefficients::PLATFORM_COEF * 1.5);
+    table.platformSlowen = Coefficients::PLATFORM_COEF * 1.3333;
+    table.platformSlowenInverse = (float)1 / (Coefficients::PLATFORM_COEF * 1.3333);
+    table.platformLongen = Coefficients::PLATFORM_COEF * 1.5;
+    table.platformLongenInverse = (float)1 / (Coefficients::PLATFORM_COEF * 1.5);
+    return table;
+}
+
+Settings::Settings() {
+    savedDiff = difficulty;
+    savedResolution = resolution;
+};
 
-Settings::Settings() {};
+// Loading only records what the save holds, so a preview can read it without touching the running game
+void Settings::apply() {
+    setDiff(savedDiff);
+    setResolution(savedResolution);
+}
 
 std::pair<Resolution, Resolution> Settings::getResolution() {
     return Settings::resolution;
@@ -590,7 +1755,8 @@ Difficulty Settings::getDiff() {
 }
 
 void Settings::setDiff(Difficulty diff) {
-    Settings::difficulty = diff;
+    Settings::difficulty = savedDiff = diff;
+    Physics::update(diff);
 }
 
 void Settings::setResolution(std::string str) {
@@ -613,45 +1779,73 @@ void Settings::setResolution(std::string str) {
     } else if (str == "Fullscreen") {
         Settings::resolution = {Resolution::FW, Resolution::FH};
     }
+    savedResolution = Settings::resolution;
 }
 
 void Settings::to_string(std::stringstream &strStream) {
-    strStream << "Settings\n" << "\tDifficulty " << difficulty << "\n\tResolution\n" << "\t\tWidth " << resolution.first << "\n\t\tHeight " << resolution.second << '\n';
+    strStream << "Settings\n" << "\tDifficulty " << savedDiff << "\n\tResolution\n" << "\t\tWidth " << savedResolution.first << "\n\t\tHeight " << savedResolution.second << '\n';
+    strStream << "\tSpace\n" << "\t\tWidth " << space.first << "\n\t\tHeight " << space.second << '\n';
 }
     
-SaveloadObject* Settings::from_string(std::stringstream &strStream) {
-    Settings* settings = new Settings();
-    std::string temp;
-    int diff;
+SaveloadObject* Settings::from_string(TextReader &reader) {
+    Settings* settings = new Settings(Difficulty::DF_MEDIUM, {Resolution::W0, Resolution::H0});
+    reader.expect("Settings");
+    int diff = reader.number<int>("Difficulty");
+    reader.expect("Resolution");
     std::pair <int, int> res;
-    strStream >> temp >> temp >> diff >> temp >> temp >> res.first >> temp >> res.second;
-    settings->setDiff((Difficulty)diff);
-    settings->setResolution(std::pair<Resolution, Resolution>((Resolution)res.first, (Resolution)res.second));
+    res.first = reader.number<int>("Width");
+    res.second = reader.number<int>("Height");
+    // Unversioned saves may lack Space, Proxy::migrate settles what it was
+    std::pair <int, int> space = {0, 0};
+    if (reader.peek("Space")) {
+        reader.expect("Space");
+        space.first = reader.number<int>("Width");
+        space.second = reader.number<int>("Height");
+    }
+    if (!reader.ok()) return settings;
+    settings->savedDiff = (Difficulty)diff;
+    settings->savedResolution = std::pair<Resolution, Resolution>((Resolution)res.first, (Resolution)res.second);
+    settings->setSpace(space);
     return settings;
 }
 
-json Settings::to_json() {
-    json seri{};
-    seri["settings"]["difficulty"] = difficulty;
-    seri["settings"]["resolution"]["width"] = resolution.first;
-    seri["settings"]["resolution"]["height"] = resolution.second;
-    return seri;
-}
-
-SaveloadObject* Settings::from_json(json &deri) {
-    int diff;
-    std::pair <int, int> res;
-    diff = deri["settings"]["difficulty"].get<int>();
-    res.first = deri["settings"]["resolution"]["width"].get<int>();
-    res.second = deri["settings"]["resolution"]["height"].get<int>();
-    Settings* settings = new Settings();
-    settings->setDiff((Difficulty)diff);
-    settings->setResolution(std::pair<Resolution, Resolution>((Resolution)res.first, (Resolution)res.second));
+void Settings::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("settings");
+    writer.beginObject();
+    writer.key("difficulty"); writer.value(savedDiff);
+    writer.key("resolution");
+    writer.beginObject();
+    writer.key("height"); writer.value(savedResolution.second);
+    writer.key("width"); writer.value(savedResolution.first);
+    writer.endObject();
+    writer.key("space");
+    writer.beginObject();
+    writer.key("height"); writer.value(space.second);
+    writer.key("width"); writer.value(space.first);
+    writer.endObject();
+    writer.endObject();
+    writer.endObject();
+}
+
+void Settings::to_binary(std::string &buf) {
+    putRecord(buf, SettingsRecord{savedDiff, savedResolution.first, savedResolution.second});
+}
+
+SaveloadObject* Settings::from_binary(const char* &cur) {
+    SettingsRecord record = getRecord<SettingsRecord>(cur);
+    Settings* settings = new Settings((Difficulty)record.difficulty, {(Resolution)record.width, (Resolution)record.height});
+    // Binary images carry no space of their own, Proxy::migrate fills it in by version
+    settings->setSpace({0, 0});
     return settings;
 }
 ///!!!
 std::string Settings::getDiffStr() {
-    switch (Settings::difficulty) {
+    return getDiffStr(Settings::difficulty);
+}
+
+std::string Settings::getDiffStr(Difficulty diff) {
+    switch (diff) {
     case Difficulty::DF_EASY:
         return "Difficulty: Easy";
         break;
@@ -704,117 +1898,346 @@ std::string Settings::getResolutionStr() {
     return "";
 }
 
-GameField::GameField() : DisplayObject(sf::Vector2f(Settings::getResolution().first, Settings::getResolution().second), sf::Vector2f(0, 0), sf::Color::Black) {}
+// The keyboard keeps no state, so every field shares one until it is handed another provider
+GameField::GameField() : DisplayObject(sf::Vector2f(Resolution::LW, Resolution::LH), sf::Vector2f(0, 0), sf::Color::Black) {
+    static KeyboardInput keyboard;
+    input = &keyboard;
+}
+
+// Obstacles, bonuses and the grid are the field's; balls, platforms and statistics are the players' unless this is a clone
+GameField::~GameField() {
+    for (Obstacle* obstacle : obstacles) {
+        delete obstacle;
+    }
+    for (Bonus* bonus : spawned) {
+        delete bonus;
+    }
+    delete grid;
+    if (!ownsPlayers) return;
+    for (Ball* ball : balls) {
+        delete ball;
+    }
+    for (Platform* platform : platforms) {
+        delete platform;
+    }
+    delete data;
+}
 
 std::vector<DisplayObject*> GameField::getObjects() {
     return objects;
 }
 
 void GameField::to_string(std::stringstream &strStream) {
-    strStream << "Gamefield\n\tObstaclesNum " << objects.size() - move_objects.size() - 1 << "\n\tTimersNum " << bonus_timers.size();
-    for (std::map<sf::Clock*, std::pair<float, EventType>> :: iterator it = bonus_timers.begin(); it != bonus_timers.end(); it++) {
-        strStream << "\n\tTimer\n\t\tTimeLeft " << it->second.first - it->first->getElapsedTime().asSeconds() << "\n\t\tEvent " << it->second.second << '\n';
+    strStream << "Gamefield\n\tObstaclesNum " << obstacles.size() << "\n\tTimersNum " << bonus_timers.size();
+    for (std::pair<long long, EventType> &timer : bonus_timers) {
+        strStream << "\n\tTimer\n\t\tTicksLeft " << timer.first - tick << "\n\t\tEvent " << timer.second << '\n';
     }
-    for (DisplayObject* obj : objects) {
-        if (dynamic_cast<Obstacle*>(obj)) {
-            obj->to_string(strStream);
+    for (Obstacle* obstacle : obstacles) {
+        obstacle->to_string(strStream);
+    }
+    if (grid) grid->to_string(strStream);
+}
+
+SaveloadObject* GameField::from_string(TextReader &reader) {
+    reader.expect("Gamefield");
+    int sizeO = reader.number<int>("ObstaclesNum");
+    int sizeT = reader.number<int>("TimersNum");
+    bonus_timers.clear();
+    legacy_timers.clear();
+    for (int i = 0; i < sizeT && reader.ok(); ++i) {
+        reader.expect("Timer");
+        if (reader.peek("TimeLeft")) {
+            double seconds = reader.number<double>("TimeLeft");
+            int event = reader.number<int>("Event");
+            legacy_timers.push_back({seconds, (EventType)event});
+            continue;
         }
+        long long ticks = reader.number<long long>("TicksLeft");
+        int event = reader.number<int>("Event");
+        addTimer({ticks, (EventType)event});
+    } 
+    std::vector<Obstacle*> reuse = clearItems();
+    obstacles.reserve(std::max(sizeO, 0));
+    for (int i = 0; i < sizeO && reader.ok(); ++i) {
+        Obstacle* obstacle = i < reuse.size() ? reuse[i] : new Obstacle(sf::Vector2f(0, 0), sf::Vector2f(0, 0), sf::Color::Black);
+        addItem((DisplayObject*)obstacle->from_string(reader));
+    }
+    for (size_t i = obstacles.size(); i < reuse.size(); ++i) {
+        delete reuse[i];
+    }
+    delete grid;
+    grid = nullptr;
+    if (reader.peek("Grid")) {
+        BrickGrid* loaded = new BrickGrid(1, 1, sf::Vector2f(0, 0), sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+        addItem((BrickGrid*)loaded->from_string(reader));
+    }
+    dirty = false;
+    return this;
+}
+
+void GameField::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    if (grid || obstacles.size() || bonus_timers.size()) {
+        writer.key("gamefield");
+        writer.beginObject();
+        if (grid) {
+            writer.key("grid");
+            grid->to_json(writer);
+        }
+        if (obstacles.size()) {
+            writer.key("obstacles");
+            writer.beginArray();
+            for (Obstacle* obstacle : obstacles) {
+                obstacle->to_json(writer);
+            }
+            writer.endArray();
+        }
+        if (bonus_timers.size()) {
+            writer.key("timers");
+            writer.beginArray();
+            for (std::pair<long long, EventType> &timer : bonus_timers) {
+                writer.beginObject();
+                writer.key("event"); writer.value(timer.second);
+                writer.key("ticks_left"); writer.value(timer.first - tick);
+                writer.endObject();
+            }
+            writer.endArray();
+        }
+        writer.endObject();
     }
+    writer.key("gamefield_obstacles_num"); writer.value(obstacles.size());
+    writer.key("gamefield_timers_num"); writer.value(bonus_timers.size());
+    writer.endObject();
 }
 
-SaveloadObject* GameField::from_string(std::stringstream &strStream) {
-    std::string temp;
-    int sizeO, sizeT;
-    strStream >> temp >> temp >> sizeO >> temp >> sizeT;
-    GameField* field = new GameField();
-    for (int i = 0; i < sizeT; ++i) {
-        float time;
-        int event;
-        strStream >> temp >> temp >> time >> temp >> event;
-        sf::Clock* clock = new sf::Clock();
-        field->addTimer({time, (EventType)event});
-    } 
-    for (int i = 0; i < sizeO; ++i) {
-        Obstacle* obstacle = new Obstacle(sf::Vector2f(0, 0), sf::Vector2f(0, 0), sf::Color::Black);
-        obstacle = (Obstacle*)obstacle->from_string(strStream);
-        field->addItem(obstacle);
+void GameField::to_binary(std::string &buf) {
+    buf.reserve(buf.size() + bonus_timers.size() * sizeof(TimerRecord) + obstacles.size() * (sizeof(ObstacleRecord) + sizeof(BonusRecord)));
+    putRecord(buf, (uint32_t)bonus_timers.size());
+    for (std::pair<long long, EventType> &timer : bonus_timers) {
+        putRecord(buf, TimerRecord{timer.first - tick, timer.second, 0});
+    }
+    putRecord(buf, (uint32_t)obstacles.size());
+    for (Obstacle* obstacle : obstacles) {
+        obstacle->to_binary(buf);
+    }
+    putRecord(buf, (uint32_t)(grid != nullptr));
+    if (grid) grid->to_binary(buf);
+}
+
+// Loads into this field: bricks and the grid are rehydrated in place, everything the players own is
+// dropped and attached again by the caller. The status bar is kept for the caller to reuse.
+SaveloadObject* GameField::from_binary(const char* &cur) {
+    bonus_timers.clear();
+    legacy_timers.clear();
+    uint32_t size = getRecord<uint32_t>(cur);
+    for (uint32_t i = 0; i < size; ++i) {
+        TimerRecord record = getRecord<TimerRecord>(cur);
+        addTimer({record.ticksLeft, (EventType)record.event});
+    }
+    std::vector<Obstacle*> reuse = clearItems();
+    size = getRecord<uint32_t>(cur);
+    obstacles.reserve(size);
+    for (uint32_t i = 0; i < size; ++i) {
+        Obstacle* obstacle = i < reuse.size() ? reuse[i] : new Obstacle(sf::Vector2f(0, 0), sf::Vector2f(0, 0), sf::Color::Black);
+        addItem((DisplayObject*)obstacle->from_binary(cur));
+    }
+    for (size_t i = obstacles.size(); i < reuse.size(); ++i) {
+        delete reuse[i];
+    }
+    BrickGrid* loaded = grid;
+    grid = nullptr;
+    if (getRecord<uint32_t>(cur)) {
+        if (!loaded) loaded = new BrickGrid(1, 1, sf::Vector2f(0, 0), sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+        addItem((BrickGrid*)loaded->from_binary(cur));
+    } else {
+        delete loaded;
     }
-    return field;
+    dirty = false;
+    return this;
 }
 
-json GameField::to_json() {
-    json seri{};
-    int j = 0;
-    for (std::map<sf::Clock*, std::pair<float, EventType>> :: iterator it = bonus_timers.begin(); it != bonus_timers.end(); it++) {
-        seri["gamefield"]["timers"][j]["time_left"] = it->second.first - it->first->getElapsedTime().asSeconds();
-        seri["gamefield"]["timers"][j]["event"] = it->second.second;
-        j++; 
+// Empties the field for a load and hands back its obstacles so the load can hydrate them; the bonuses go,
+// the load brings its own
+std::vector<Obstacle*> GameField::clearItems() {
+    std::vector<Obstacle*> reuse;
+    reuse.swap(obstacles);
+    for (Bonus* bonus : spawned) {
+        delete bonus;
     }
-    j = 0;
-    for (int i = 0; i < objects.size(); ++i) {
-        if (dynamic_cast<Obstacle*>(objects[i])) {
-            seri["gamefield"]["obstacles"][j] = objects[i]->to_json();
-            j++;
+    spawned.clear();
+    objects.clear();
+    move_objects.clear();
+    balls.clear();
+    platforms.clear();
+    bonuses.clear();
+    motion.clear();
+    stored = 0;
+    return reuse;
+}
+
+// One flag per obstacle and one per grid cell, the bits deltas flip,
+// then per obstacle whether it has released its bonus and whether that bonus is still visible
+std::vector<bool> GameField::getVisibility() {
+    std::vector<bool> visible;
+    visible.reserve(obstacles.size() * 3 + (grid ? grid->getCells().size() : 0));
+    for (Obstacle* obstacle : obstacles) {
+        visible.push_back(obstacle->isVisible());
+    }
+    if (grid) {
+        for (uint8_t cell : grid->getCells()) {
+            visible.push_back(cell & BrickCell::BC_ALIVE);
         }
     }
-    seri["gamefield_timers_num"] = bonus_timers.size();
-    seri["gamefield_obstacles_num"] = j;
-    return seri;
+    for (Obstacle* obstacle : obstacles) {
+        visible.push_back(obstacle->getReleased());
+    }
+    for (Obstacle* obstacle : obstacles) {
+        visible.push_back(obstacle->getReleased() && obstacle->getReleased()->isVisible());
+    }
+    return visible;
 }
 
-SaveloadObject* GameField::from_json(json &deri) {
-    GameField* field = new GameField();
-    int size = deri["gamefield_timers_num"].get<int>();
-    for (int i = 0; i < size; ++i) {
-        sf::Clock* clock = new sf::Clock();
-        field->addTimer({deri["gamefield"]["timers"][i]["time_left"].get<float>(), (EventType)deri["gamefield"]["timers"][i]["event"].get<int>()});
-    } 
-    size = deri["gamefield_obstacles_num"].get<int>();
-    for (int i = 0; i < size; ++i) {
-        Obstacle* obstacle = new Obstacle(sf::Vector2f(0, 0), sf::Vector2f(0, 0), sf::Color::Black);
-        obstacle = (Obstacle*)obstacle->from_json(deri["gamefield"]["obstacles"][i]);
-        field->addItem(obstacle);
+// Timers are written whole, bricks as a bitset of visibility flips since the previous record,
+// and released bonuses only when new, falling or on the record that sees them gone
+void GameField::to_delta(std::string &buf, std::vector<bool> &visible) {
+    putRecord(buf, (uint32_t)bonus_timers.size());
+    for (std::pair<long long, EventType> &timer : bonus_timers) {
+        putRecord(buf, TimerRecord{timer.first - tick, timer.second, 0});
+    }
+    std::vector<bool> current = getVisibility();
+    size_t bricks = current.size() - obstacles.size() * 2;
+    std::string flipped((bricks + 7) / 8, '\0');
+    for (size_t i = 0; i < bricks; ++i) {
+        if (current[i] == visible[i]) continue;
+        flipped[i / 8] |= 1 << (i % 8);
+    }
+    putRecord(buf, (uint32_t)bricks);
+    buf += flipped;
+    std::vector<uint32_t> released;
+    for (uint32_t i = 0; i < obstacles.size(); ++i) {
+        size_t present = bricks + i, falling = bricks + obstacles.size() + i;
+        if (current[present] != visible[present] || current[falling] || visible[falling]) released.push_back(i);
     }
-    return field;
+    putRecord(buf, (uint32_t)released.size());
+    for (uint32_t i : released) {
+        putRecord(buf, i);
+        obstacles[i]->getReleased()->to_binary(buf);
+    }
+    visible.swap(current);
 }
 
-void GameField::freezeTimers() {
-    for (std::map<sf::Clock*, std::pair<float, EventType>> :: iterator it = bonus_timers.begin(); it != bonus_timers.end(); it++) {
-        it->second.first -= it->first->restart().asSeconds();
+bool GameField::apply_delta(const char* &cur) {
+    bonus_timers.clear();
+    uint32_t size = getRecord<uint32_t>(cur);
+    for (uint32_t i = 0; i < size; ++i) {
+        TimerRecord record = getRecord<TimerRecord>(cur);
+        addTimer({record.ticksLeft, (EventType)record.event});
+    }
+    size = getRecord<uint32_t>(cur);
+    if (size != obstacles.size() + (grid ? grid->getCells().size() : 0)) return false;
+    const char* flipped = cur;
+    cur += (size + 7) / 8;
+    for (uint32_t i = 0; i < size; ++i) {
+        if (!(flipped[i / 8] >> (i % 8) & 1)) continue;
+        if (i < obstacles.size()) {
+            obstacles[i]->setVisible(!obstacles[i]->isVisible());
+        } else {
+            grid->toggleCell(i - obstacles.size());
+        }
     }
+    size = getRecord<uint32_t>(cur);
+    for (uint32_t i = 0; i < size; ++i) {
+        uint32_t index = getRecord<uint32_t>(cur);
+        BonusRecord record = getRecord<BonusRecord>(cur);
+        if (index >= obstacles.size()) return false;
+        Bonus* bonus = obstacles[index]->getReleased();
+        if (!bonus) {
+            bonus = new Bonus(sf::Vector2f(record.width, record.height), sf::Vector2f(record.x, record.y), record.yVelocity, (EventType)record.type);
+            obstacles[index]->setReleased(bonus);
+            spawned.push_back(bonus);
+            bonuses.push_back(bonus);
+            bonus->attach(&motion);
+            move_objects.push_back(bonus);
+            objects.push_back(bonus);
+        }
+        bonus->setPosition(sf::Vector2f(record.x, record.y));
+        bonus->setVelocity(sf::Vector2f(0, record.yVelocity));
+        bonus->setVisible(record.visible);
+    }
+    dirty = true;
+    return true;
+}
+
+// Timers are a min-heap on the expiry tick; tick only advances in update(), so pauses need no bookkeeping
+void GameField::addTimer(std::pair<long long, EventType> data) {
+    bonus_timers.push_back({tick + data.first, data.second});
+    std::push_heap(bonus_timers.begin(), bonus_timers.end(), std::greater<std::pair<long long, EventType>>());
+}
+
+void GameField::addLegacyTimers(const std::vector<std::pair<double, EventType>> &timers) {
+    legacy_timers.insert(legacy_timers.end(), timers.begin(), timers.end());
 }
 
-void GameField::startTimers() {
-    for (std::map<sf::Clock*, std::pair<float, EventType>> :: iterator it = bonus_timers.begin(); it != bonus_timers.end(); it++) {
-        it->first->restart();
+void GameField::migrateTimers() {
+    for (std::pair<double, EventType> &timer : legacy_timers) {
+        addTimer({llround(timer.first * 1000000 / Timing::TICK_USEC), timer.second});
     }
+    legacy_timers.clear();
 }
 
 void GameField::draw(sf::RenderWindow &target) {
+    PROFILE_ZONE("GameField::draw");
     target.draw(*shape);
     for (DisplayObject* obj : objects) {
         obj->draw(target);
     }
 }
 
+void GameField::rasterize(Canvas &canvas) {
+    canvas.clear(color);
+    for (DisplayObject* obj : objects) {
+        obj->rasterize(canvas);
+    }
+}
+
+// The field itself always spans the logical extent, only what it holds is rescaled.
+// Released bonuses can be compacted out of objects while their obstacle still owns them, so collect every owner once
+void GameField::scaleBound(sf::Vector2f koef) {
+    std::vector<DisplayObject*> scaled = objects;
+    for (Obstacle* obstacle : obstacles) {
+        scaled.push_back(obstacle);
+        if (obstacle->getReleased()) scaled.push_back(obstacle->getReleased());
+    }
+    scaled.insert(scaled.end(), move_objects.begin(), move_objects.end());
+    std::sort(scaled.begin(), scaled.end());
+    scaled.erase(std::unique(scaled.begin(), scaled.end()), scaled.end());
+    for (DisplayObject* obj : scaled) {
+        obj->scaleBound(koef);
+    }
+}
+
 void GameField::addItem(DisplayObject *obj) {
     objects.push_back(obj);
-    if (dynamic_cast<Obstacle*>(obj) && !obj->isVisible()) {
-        for (Bonus* bonus : ((Obstacle*)obj)->getBonuses()) {
-            bonuses.push_back(bonus);
-            move_objects.push_back(bonus);
-            objects.push_back(bonus);
-        }
+    if (dynamic_cast<Obstacle*>(obj)) obstacles.push_back((Obstacle*)obj);
+    if (dynamic_cast<Obstacle*>(obj) && ((Obstacle*)obj)->getReleased()) {
+        Bonus* bonus = ((Obstacle*)obj)->getReleased();
+        spawned.push_back(bonus);
+        bonuses.push_back(bonus);
+        bonus->attach(&motion);
+        move_objects.push_back(bonus);
+        objects.push_back(bonus);
     }
 }
 
 void GameField::addItem(Ball *obj) {
+    obj->attach(&motion);
     move_objects.push_back(obj);
     objects.push_back(obj);
     balls.push_back(obj);
 }
 
 void GameField::addItem(Platform *obj) {
+    obj->attach(&motion);
     move_objects.push_back(obj);
     objects.push_back(obj);
     platforms.push_back(obj);
@@ -824,6 +2247,11 @@ void GameField::addItem(Statistics *obj) {
     data = obj;
 }
 
+void GameField::addItem(BrickGrid *obj) {
+    grid = obj;
+    objects.push_back(obj);
+}
+
 void GameField::addItem(StatusBar *obj) {
     board = obj;
     objects.push_back(obj);
@@ -834,168 +2262,478 @@ Statistics* GameField::getData() {
 }
 
 void GameField::eventHandler(Event e) {
-    int aliveObj = 0, aliveMoveObj = 0;
+    int aliveObj = 0;
     switch (e.type) {
     case EventType::BALL_FASTEN:
-        bonus_timers.insert({new sf::Clock(), {(float)10, EventType::BALL_FASTEN_DECLINE}});
+        addTimer({Timing::BONUS_TICKS, EventType::BALL_FASTEN_DECLINE});
         for (Ball* ball : balls) {
-            ball->scaleSpeed(Coefficients::BALL_COEF * 1.3333);
+            ball->scaleSpeed(Physics::get().ballFasten);
             ball->setScale();
         }
         break;
     case EventType::BALL_FASTEN_DECLINE:
         for (Ball* ball : balls) {
-            ball->scaleSpeed((float)1 / (Coefficients::BALL_COEF * 1.3333));
+            ball->scaleSpeed(Physics::get().ballFastenInverse);
             ball->setScale();
         }
         break;
     case EventType::BALL_SLOWEN:
-        bonus_timers.insert({new sf::Clock(), {(float)10, EventType::BALL_SLOWEN_DECLINE}});
+        addTimer({Timing::BONUS_TICKS, EventType::BALL_SLOWEN_DECLINE});
         for (Ball* ball : balls) {
-            ball->scaleSpeed((float)1 / (Coefficients::BALL_COEF * 1.5));
+            ball->scaleSpeed(Physics::get().ballSlowenInverse);
             ball->setScale();
         }
         break;
     case EventType::BALL_SLOWEN_DECLINE:
         for (Ball* ball : balls) {
-            ball->scaleSpeed(Coefficients::BALL_COEF * 1.5);
+            ball->scaleSpeed(Physics::get().ballSlowen);
             ball->setScale();
         }
         break;
     case EventType::PLATFORM_FASTEN:
-        bonus_timers.insert({new sf::Clock(), {(float)10, EventType::PLATFORM_FASTEN_DECLINE}});
+        addTimer({Timing::BONUS_TICKS, EventType::PLATFORM_FASTEN_DECLINE});
         for (Platform* platform : platforms) {
-            platform->scaleSpeed(Coefficients::PLATFORM_COEF * 1.5);
+            platform->scaleSpeed(Physics::get().platformFasten);
             platform->setScale();
         }
         break;
     case EventType::PLATFORM_FASTEN_DECLINE:
         for (Platform* platform : platforms) {
-            platform->scaleSpeed((float)1 / (Coefficients::PLATFORM_COEF * 1.5));
+            platform->scaleSpeed(Physics::get().platformFastenInverse);
             platform->setScale();
         }
         break;
     case EventType::PLATFORM_SLOWEN:
-        bonus_timers.insert({new sf::Clock(), {(float)10, EventType::PLATFORM_SLOWEN_DECLINE}});
+        addTimer({Timing::BONUS_TICKS, EventType::PLATFORM_SLOWEN_DECLINE});
         for (Platform* platform : platforms) {
-            platform->scaleSpeed((float)1 / (Coefficients::PLATFORM_COEF * 1.3333));
+            platform->scaleSpeed(Physics::get().platformSlowenInverse);
             platform->setScale();
         }
         break;
     case EventType::PLATFORM_SLOWEN_DECLINE:
         for (Platform* platform : platforms) {
-            platform->scaleSpeed(Coefficients::PLATFORM_COEF * 1.3333);
+            platform->scaleSpeed(Physics::get().platformSlowen);
             platform->setScale();
         }
         break;
     case EventType::PLATFORM_LONGEN:
-        bonus_timers.insert({new sf::Clock(), {(float)10, EventType::PLATFORM_LONGEN_DECLINE}});
+        addTimer({Timing::BONUS_TICKS, EventType::PLATFORM_LONGEN_DECLINE});
         for (Platform* platform : platforms) {
-            platform->scale(Coefficients::PLATFORM_COEF * 1.5);
+            platform->scale(Physics::get().platformLongen);
         }
         break;
     case EventType::PLATFORM_LONGEN_DECLINE:
         for (Platform* platform : platforms) {
-            platform->scale((float)1 / (Coefficients::PLATFORM_COEF * 1.5));
+            platform->scale(Physics::get().platformLongenInverse);
         }
         break;
     case EventType::PLATFORM_SHORTEN:
-        bonus_timers.insert({new sf::Clock(), {(float)10, EventType::PLATFORM_SHORTEN_DECLINE}});
+        addTimer({Timing::BONUS_TICKS, EventType::PLATFORM_SHORTEN_DECLINE});
         for (Platform* platform : platforms) {
-            platform->scale((float)1 / (Coefficients::PLATFORM_COEF * 1.5));
+            platform->scale(Physics::get().platformLongenInverse);
         }
         break;
     case EventType::PLATFORM_SHORTEN_DECLINE:
         for (Platform* platform : platforms) {
-            platform->scale(Coefficients::PLATFORM_COEF * 1.5);
+            platform->scale(Physics::get().platformLongen);
         }
         break;
     case EventType::BONUS:
+        spawned.push_back((Bonus*)e.obj);
         bonuses.push_back((Bonus*)e.obj);
+        ((MovableObject*)e.obj)->attach(&motion);
         move_objects.push_back((MovableObject*)e.obj);
         objects.push_back(e.obj);
         break;
     case EventType::BONUS_CATCHED:
         data->setCatched(data->getCatched() + 1);
+        dirty = true;
         break;
     case EventType::LIVES_DOWN:
         data->setLives(data->getLives() - 1);
         if (data->getLives() <= 0) {
-            EventDispatcher::setEvent({EventType::LOSE, nullptr});
+            finish(EventType::LOSE);
         }
         break;
     case EventType::SCORE_UP:
         data->setScore(data->getScore() + 10);
         break;
+    case EventType::BONUS_FALL:
+        dirty = true;
+        break;
     case EventType::COLLISION:
-        for (DisplayObject* obj : objects) {
-            if (obj->isVisible()) aliveObj++;
-        }
-        for (MovableObject* obj : move_objects) {
-            if (obj->isVisible()) aliveMoveObj++;
+        dirty = true;
+        for (Obstacle* obstacle : obstacles) {
+            if (obstacle->isVisible()) aliveObj++;
         }
-        if (aliveObj - 1 == aliveMoveObj) {
-            EventDispatcher::setEvent({EventType::WIN, nullptr});
+        if (grid) aliveObj += grid->getAlive();
+        if (aliveObj == 0) {
+            finish(EventType::WIN);
         }
         break;
     }
 }
 
 void GameField::moveObjects() {
-    for (MovableObject* obj : move_objects) {
-        if (dynamic_cast<Platform*>(obj)) continue;
-        obj->move();
-    }
-    float platformSpeed = Platform(sf::Vector2f(0, 0)).getBaseSpeedAbs();
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) {
-        for (Platform* platform : platforms) {
-            platform->setVelocity(sf::Vector2f(-platformSpeed, 0));
-            platform->setScale();
-            platform->move();
-        }
-    } else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) {
-        for (Platform* platform : platforms) {
-            platform->setVelocity(sf::Vector2f(platformSpeed, 0));
-            platform->setScale();
-            platform->move();
-        }
+    PROFILE_ZONE("moveObjects");
+    motion.move();
+    int direction = input->steer(this);
+    if (!direction) return;
+    float platformSpeed = Physics::get().platformSpeed * direction;
+    for (Platform* platform : platforms) {
+        platform->setVelocity(sf::Vector2f(platformSpeed, 0));
+        platform->setScale();
+        platform->move();
     }
 }
 
 void GameField::checkCollisions() {
+    PROFILE_ZONE("checkCollisions");
     for (MovableObject* obj1: move_objects) {
         for (DisplayObject* obj2: objects) {
             if (obj1 == obj2 
                 || !obj1->isVisible() 
                 || !obj2->isVisible() 
+                || obj2 == grid
                 || std::find(balls.begin(), balls.end(), obj2) != balls.end()) continue;
             obj1->checkCollision(obj2);
         }
+        if (grid && obj1->isVisible() && std::find(balls.begin(), balls.end(), obj1) != balls.end()) grid->checkCollision(obj1);
         if (obj1->isVisible()) obj1->checkBounds();
     }
 }
 
+// A headless field points the objects at its own random stream for the tick
 void GameField::update(sf::Vector2i mousePos, bool pressed) {
+    PROFILE_ZONE("GameField::update");
+    if (headless) activeRng = &random;
     moveObjects();
     checkCollisions();
-    std::vector<sf::Clock*> to_delete;
-    for (std::map<sf::Clock*, std::pair<float, EventType>> :: iterator it = bonus_timers.begin(); it != bonus_timers.end(); it++) {
-        if (it->first->getElapsedTime().asSeconds() > it->second.first) {
-            EventDispatcher::setGameEvent({it->second.second, nullptr});
-            to_delete.push_back(it->first);
+    tick++;
+    while (!bonus_timers.empty() && bonus_timers.front().first <= tick) {
+        EventDispatcher::setGameEvent({bonus_timers.front().second, nullptr});
+        std::pop_heap(bonus_timers.begin(), bonus_timers.end(), std::greater<std::pair<long long, EventType>>());
+        bonus_timers.pop_back();
+    }
+    {
+        PROFILE_ZONE("game events");
+        Event e;
+        while (EventDispatcher::pollGameEvent(e)) {
+            for (DisplayObject* obj : objects) {
+                obj->eventHandler(e);
+            }
+            eventHandler(e);
+        }
+    }
+    if (dirty) compactObjects();
+    if (rewindTicks && tick % rewindTicks == 0) capture();
+    if (board) board->update(data, mousePos, pressed);
+    activeRng = &rng;
+}
+
+void GameField::finish(EventType outcome) {
+    if (headless) {
+        result = outcome;
+    } else {
+        EventDispatcher::setEvent({outcome, nullptr});
+    }
+}
+
+// Headless copy for lookahead. Obstacles, balls, bonuses and the grid share their shapes and textures with
+// this field and only their state is copied, so a clone is never drawn or rescaled and must not outlive this field.
+// It keeps no rewind ring, reports the end of the round through getResult() and can be stepped on any thread.
+// Deleting it frees the copies and leaves the shared shapes alone
+GameField* GameField::clone() {
+    GameField* copy = new GameField();
+    copy->headless = true;
+    copy->ownsPlayers = true;
+    copy->tick = tick;
+    copy->bonus_timers = bonus_timers;
+    copy->motion = motion;
+    copy->dirty = dirty;
+    copy->result = result;
+    copy->random = headless ? random : rng;
+    copy->input = input;
+    copy->data = new Statistics(data->getLives(), data->getScore(), data->getCatched(), data->getName(), data->getTime());
+    std::vector<std::pair<DisplayObject*, DisplayObject*>> copies;
+    copies.reserve(obstacles.size() * 2 + move_objects.size() + balls.size() + platforms.size() + 1);
+    auto find = [&copies](DisplayObject* obj) -> DisplayObject* {
+        auto it = std::lower_bound(copies.begin(), copies.end(), std::make_pair(obj, (DisplayObject*)nullptr));
+        return it != copies.end() && it->first == obj ? it->second : nullptr;
+    };
+    auto movable = [&](MovableObject* obj, MovableObject* dup) {
+        if (obj->attachedTo(&motion)) dup->rebind(&copy->motion);
+        copies.push_back({obj, dup});
+        return dup;
+    };
+    copy->obstacles.reserve(obstacles.size());
+    for (Obstacle* obstacle : obstacles) {
+        Obstacle* dup = new Obstacle(*obstacle);
+        if (obstacle->getReleased()) {
+            dup->setReleased((Bonus*)movable(obstacle->getReleased(), new Bonus(*obstacle->getReleased())));
+            copy->spawned.push_back(dup->getReleased());
         }
+        copy->obstacles.push_back(dup);
+        copies.push_back({obstacle, dup});
+    }
+    if (grid) {
+        copy->grid = new BrickGrid(*grid);
+        copies.push_back({grid, copy->grid});
     }
-    for (int i = 0; i < to_delete.size(); i++) {
-        bonus_timers.erase(to_delete[i]);
+    // Bonuses dropped by the grid have no obstacle to own them
+    std::sort(copies.begin(), copies.end());
+    std::vector<Bonus*> loose;
+    for (Bonus* bonus : bonuses) {
+        if (!find(bonus)) loose.push_back(bonus);
+    }
+    for (Bonus* bonus : loose) copy->spawned.push_back((Bonus*)movable(bonus, new Bonus(*bonus)));
+    for (Ball* ball : balls) movable(ball, new Ball(*ball));
+    for (Platform* platform : platforms) movable(platform, new Platform(*platform));
+    std::sort(copies.begin(), copies.end());
+    copy->objects.reserve(objects.size());
+    // The status bar is still the ceiling the balls bounce off, it is shared but never updated by the clone
+    for (DisplayObject* obj : objects) {
+        DisplayObject* dup = find(obj);
+        copy->objects.push_back(dup ? dup : obj);
+    }
+    copy->move_objects.reserve(move_objects.size());
+    for (MovableObject* obj : move_objects) copy->move_objects.push_back((MovableObject*)find(obj));
+    for (Ball* ball : balls) copy->balls.push_back((Ball*)find(ball));
+    for (Platform* platform : platforms) copy->platforms.push_back((Platform*)find(platform));
+    for (Bonus* bonus : bonuses) copy->bonuses.push_back((Bonus*)find(bonus));
+    return copy;
+}
+
+// Clones a level, steps the copy under the autopilot and deletes it, round after round. The level must come out
+// as it went in, and under a leak checker every round must give back all it took
+void GameField::benchmark(int rounds) {
+    GameField level;
+    Player player("Bench");
+    Autopilot pilot;
+    level.addItem(player.getPlatform());
+    level.addItem(player.getBalls()[0]);
+    level.addItem(player.getStatistics());
+    level.addLevel();
+    level.setInput(&pilot);
+    std::string before, after;
+    level.to_binary(before);
+    player.to_binary(before);
+    long long ticks = 0;
+    sf::Clock clock;
+    for (int i = 0; i < rounds; ++i) {
+        GameField* copy = level.clone();
+        copy->reseed(i);
+        for (int t = 0; t < Timing::LOOKAHEAD_TICKS && copy->getResult() == EventType::START; ++t) {
+            copy->update(sf::Vector2i(0, 0), false);
+            ticks++;
+        }
+        delete copy;
+    }
+    float seconds = clock.getElapsedTime().asSeconds();
+    level.to_binary(after);
+    player.to_binary(after);
+    std::cout << rounds << " clones of " << level.getObstacles().size() << " obstacles, " << ticks << " ticks: "
+              << seconds * 1000000 / std::max(rounds, 1) << " us per round, original " << (before == after ? "untouched" : "CHANGED") << '\n';
+}
+
+void GameField::setRewind(int ticks, int depth) {
+    rewindTicks = ticks;
+    snapshots.assign(std::max(depth, 0), FieldSnapshot());
+    newest = 0;
+    stored = 0;
+}
+
+// Taken after compaction, so the lists hold exactly the live objects
+void GameField::capture() {
+    PROFILE_ZONE("rewind capture");
+    if (snapshots.empty()) return;
+    newest = (newest + 1) % snapshots.size();
+    stored = std::min(stored + 1, snapshots.size());
+    snapshot(snapshots[newest]);
+}
+
+void GameField::snapshot(FieldSnapshot &snap) {
+    snap.tick = tick;
+    snap.timers = bonus_timers;
+    snap.motion = motion;
+    snap.objects = objects;
+    snap.moveObjects = move_objects;
+    snap.bonuses = bonuses;
+    snap.spawned = spawned.size();
+    snap.released.resize(obstacles.size());
+    snap.bricks.resize(obstacles.size() + (grid ? grid->getCells().size() : 0));
+    for (size_t i = 0; i < obstacles.size(); ++i) {
+        snap.released[i] = obstacles[i]->getReleased();
+        snap.bricks[i] = obstacles[i]->isVisible();
+    }
+    for (size_t i = obstacles.size(); i < snap.bricks.size(); ++i) {
+        snap.bricks[i] = grid->getCells()[i - obstacles.size()] & BrickCell::BC_ALIVE;
+    }
+    snap.platformWidths.resize(platforms.size());
+    for (size_t i = 0; i < platforms.size(); ++i) {
+        snap.platformWidths[i] = platforms[i]->getBound().width;
+    }
+    snap.lives = data->getLives();
+    snap.score = data->getScore();
+    snap.catched = data->getCatched();
+    snap.time = data->getTime();
+    snap.result = result;
+    snap.rng = headless ? random : rng;
+}
+
+// Restores the snapshot steps back and forgets it and everything newer. Bonuses released since
+// then fall out with the lists, the way compaction lets go of dead ones
+bool GameField::rewind(int steps) {
+    if (steps < 1 || steps > stored) return false;
+    size_t target = (newest + snapshots.size() - (steps - 1)) % snapshots.size();
+    restore(snapshots[target]);
+    newest = (target + snapshots.size() - 1) % snapshots.size();
+    stored -= steps;
+    return true;
+}
+
+void GameField::restore(const FieldSnapshot &snap) {
+    // Platform shapes carry their length in the shape scale, so resize them before the boxes come back
+    for (size_t i = 0; i < platforms.size() && i < snap.platformWidths.size(); ++i) {
+        platforms[i]->scale(snap.platformWidths[i] / platforms[i]->getBound().width);
+    }
+    tick = snap.tick;
+    bonus_timers = snap.timers;
+    motion = snap.motion;
+    motion.claim();
+    objects = snap.objects;
+    move_objects = snap.moveObjects;
+    bonuses = snap.bonuses;
+    for (size_t i = snap.spawned; i < spawned.size(); ++i) {
+        delete spawned[i];
+    }
+    spawned.resize(std::min(spawned.size(), snap.spawned));
+    for (size_t i = 0; i < obstacles.size() && i < snap.released.size(); ++i) {
+        obstacles[i]->setReleased(snap.released[i]);
+        obstacles[i]->setVisible(snap.bricks[i]);
+    }
+    for (size_t i = obstacles.size(); i < snap.bricks.size(); ++i) {
+        int cell = i - obstacles.size();
+        if (snap.bricks[i] != (bool)(grid->getCells()[cell] & BrickCell::BC_ALIVE)) grid->toggleCell(cell);
+    }
+    data->setLives(snap.lives);
+    data->setScore(snap.score);
+    data->setCatched(snap.catched);
+    data->setTime(snap.time);
+    result = snap.result;
+    (headless ? random : rng) = snap.rng;
+    dirty = false;
+}
+
+// Starts a level that was restored to its first tick over as a new round: the field's random stream
+// is seeded and every brick draws its bonus again
+void GameField::reseed(uint64_t seed) {
+    std::mt19937_64* outer = activeRng;
+    activeRng = headless ? &random : &rng;
+    activeRng->seed(seed);
+    for (Obstacle* obstacle : obstacles) {
+        obstacle->setBonus(rollBonus());
+    }
+    if (grid) grid->refill();
+    activeRng = outer;
+}
+
+// Lays the bricks out for the current difficulty, as a grid once there are too many to keep as objects.
+// The level scale multiplies rows and columns, so a scale of 30 gives over 100k bricks
+void GameField::addLevel() {
+    std::vector <Obstacle*> blocks;
+    sf::Vector2f fullResolution = sf::Vector2f(Resolution::LW, Resolution::LH);
+    int rowNum = ObstacleNum::OB_ROW / (6.5 - Settings::getDiff()) * Settings::getLevelScale();
+    int columnNum = ObstacleNum::OB_COLUMN / (6.5 - Settings::getDiff()) * Settings::getLevelScale();
+    float gapWidth = (float)fullResolution.x / columnNum / 20;
+    float gapHeight = (float)(fullResolution.y - fullResolution.y / 20) / 2 / rowNum / 10;
+    float obstacleWidth = (float)fullResolution.x / columnNum - gapWidth * 2;
+    float obstacleHeight = (float)(fullResolution.y - fullResolution.y / 20) / 2 / rowNum - gapHeight * 2;
+    sf::Vector2f obstacleSize = sf::Vector2f(obstacleWidth, obstacleHeight);
+    if (rowNum * columnNum > ObstacleNum::OB_COMPACT) {
+        addItem(new BrickGrid(
+            rowNum,
+            columnNum,
+            sf::Vector2f(gapWidth, gapHeight + fullResolution.y / 20),
+            sf::Vector2f(obstacleWidth + gapWidth * 2, obstacleHeight + gapHeight * 2),
+            obstacleSize
+        ));
+        rowNum = columnNum = 0;
     }
-    Event e;
-    while (EventDispatcher::pollGameEvent(e)) {
-        for (DisplayObject* obj : objects) {
-            obj->eventHandler(e);
+    for (int h = 0; h < rowNum; ++h) {
+        for (int w = 0; w < columnNum; ++w) {
+            blocks.push_back(new Obstacle(
+                obstacleSize,
+                sf::Vector2f((gapWidth + obstacleWidth) * w + gapWidth * (w + 1), (gapHeight + obstacleHeight) * h + gapHeight * (h + 1) + fullResolution.y / 20),
+                sf::Color::Yellow
+            ));
         }
-        eventHandler(e);
     }
-    board->update(data, mousePos, pressed);
+    for (Obstacle* block : blocks) {
+        addItem((DisplayObject*)block);
+    }
+}
+
+void GameField::compactObjects() {
+    PROFILE_ZONE("compactObjects");
+    // Dead objects stay owned by obstacles/balls so save/load still sees them, but give back their motion slots
+    auto dead = [](DisplayObject* obj) { return !obj->isVisible(); };
+    for (MovableObject* obj : move_objects) {
+        if (dead(obj)) obj->detach();
+    }
+    objects.erase(std::remove_if(objects.begin(), objects.end(), dead), objects.end());
+    move_objects.erase(std::remove_if(move_objects.begin(), move_objects.end(), dead), move_objects.end());
+    bonuses.erase(std::remove_if(bonuses.begin(), bonuses.end(), dead), bonuses.end());
+    dirty = false;
+}
+
+int KeyboardInput::steer(GameField* field) {
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) return -1;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) return 1;
+    return 0;
+}
+
+bool Autopilot::wanted(EventType bonus) {
+    return bonus == EventType::PLATFORM_LONGEN || bonus == EventType::PLATFORM_FASTEN || bonus == EventType::BALL_SLOWEN;
+}
+
+// Landing points fold the straight flight back into the field at the side walls; a rising ball is
+// shadowed, since bricks make where it comes back down unpredictable
+int Autopilot::steer(GameField* field) {
+    if (field->getPlatforms().empty()) return 0;
+    sf::FloatRect platform = field->getPlatforms()[0]->getBound();
+    float center = platform.left + platform.width / 2, speed = Physics::get().platformSpeed;
+    Ball* lowest = nullptr;
+    for (Ball* ball : field->getBalls()) {
+        if (ball->isVisible() && (!lowest || ball->getBound().top > lowest->getBound().top)) lowest = ball;
+    }
+    if (!lowest) return 0;
+    sf::FloatRect ball = lowest->getBound();
+    sf::Vector2f velocity = lowest->getVelocity();
+    float target = ball.left + ball.width / 2, landing = std::numeric_limits<float>::infinity();
+    if (velocity.y > 0) {
+        landing = std::max(0.0f, (platform.top - ball.top - ball.height) / velocity.y);
+        float span = Resolution::LW - ball.width;
+        float x = std::fmod(ball.left + velocity.x * landing, 2 * span);
+        if (x < 0) x += 2 * span;
+        if (x > span) x = 2 * span - x;
+        target = x + ball.width / 2;
+    }
+    if (catchBonuses) {
+        float soonest = std::numeric_limits<float>::infinity();
+        for (Bonus* bonus : field->getBonuses()) {
+            if (!bonus->isVisible() || !wanted(bonus->getBonus()) || bonus->getVelocity().y <= 0) continue;
+            sf::FloatRect box = bonus->getBound();
+            float fall = (platform.top - box.top - box.height) / bonus->getVelocity().y;
+            float x = box.left + box.width / 2;
+            float reach = fabs(x - center) / speed, back = fabs(target - x) / speed;
+            if (fall < 0 || reach > fall || std::max(fall, reach) + back > landing || fall >= soonest) continue;
+            soonest = fall;
+            target = x;
+        }
+    }
+    if (fabs(target - center) <= speed) return 0;
+    return target < center ? -1 : 1;
 }
 
 Player::Player(Statistics* s, Platform* p, std::vector <Ball*> b) {
@@ -1004,32 +2742,36 @@ Player::Player(Statistics* s, Platform* p, std::vector <Ball*> b) {
     balls = b;
 }
 
+Player::~Player() {
+    delete stats;
+    delete platform;
+    for (Ball* ball : balls) {
+        delete ball;
+    }
+}
+
 Player::Player(std::string name) {
-    float platformWidth = Settings::getResolution().first * PlatformSize::PS_MEDIUM / 1000;
-    float platformHeight = Settings::getResolution().second * PlatformSize::PS_HEIGHT / 1000;
-    float platformSpeed = Platform(sf::Vector2f(0, 0)).getBaseSpeedAbs();
+    const PhysicsConstants &physics = Physics::get();
     platform = new Platform(
         sf::Vector2f(
-            platformWidth,
-            platformHeight
+            physics.platformWidth,
+            physics.platformHeight
         ), 
         sf::Vector2f(
-            (Settings::getResolution().first - platformWidth) / 2,
-            Settings::getResolution().second - platformHeight
+            (Resolution::LW - physics.platformWidth) / 2,
+            Resolution::LH - physics.platformHeight
         ),
         sf::Color::Blue,
-        platformSpeed
+        physics.platformSpeed
     );
-    float ballSize = Settings::getResolution().second * BallSize::BS_MEDIUM / 1000;
-    float ballSpeed = Ball(0).getBaseSpeedAbs(Settings::getDiff());
     Ball *ball = new Ball(
-        ballSize,
+        physics.ballSize,
         sf::Vector2f(
-            (Settings::getResolution().first - 2 * ballSize) / 2,
-            Settings::getResolution().second - platformHeight - 2 * ballSize
+            (Resolution::LW - 2 * physics.ballSize) / 2,
+            Resolution::LH - physics.platformHeight - 2 * physics.ballSize
         ),
         sf::Color::Cyan,
-        sf::Vector2f(sqrt(ballSpeed / 2.0), sqrt(ballSpeed / 2.0))
+        sf::Vector2f(physics.ballLaunch, physics.ballLaunch)
     );
     balls.push_back(ball);
     stats = new Statistics(3, 0, 0, name);
@@ -1053,48 +2795,65 @@ void Player::to_string(std::stringstream &strStream) {
     }
 }
 
-SaveloadObject* Player::from_string(std::stringstream &strStream) {
-    std::string temp;
-    strStream >> temp;
-    Statistics* stats = new Statistics(0, 0, 0, "");
-    stats = (Statistics*)stats->from_string(strStream);
-    Platform* platform = new Platform(sf::Vector2f(0, 0), sf::Vector2f(0, 0));
-    platform = (Platform*)platform->from_string(strStream);
-    int size;
-    strStream >> temp >> temp >> size;
+// The loaders build new objects, so the blanks they are called on live on the stack
+SaveloadObject* Player::from_string(TextReader &reader) {
+    reader.expect("Player");
+    Statistics blankStats(0, 0, 0, "");
+    Platform blankPlatform(sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+    Ball blankBall(0, sf::Vector2f(0, 0), sf::Color::Black);
+    Statistics* stats = (Statistics*)blankStats.from_string(reader);
+    Platform* platform = (Platform*)blankPlatform.from_string(reader);
+    reader.expect("Balls");
+    int size = reader.number<int>("BallsNum");
     std::vector <Ball*> balls;
-    for (int i = 0; i < size; ++i) {
-        Ball* ball = new Ball(0, sf::Vector2f(0, 0), sf::Color::Black);
-        ball = (Ball*)ball->from_string(strStream);
+    for (int i = 0; i < size && reader.ok(); ++i) {
+        Ball* ball = (Ball*)blankBall.from_string(reader);
         balls.push_back(ball);
     }
     Player* player = new Player(stats, platform, balls);
     return player;
 }
 
-json Player::to_json() {
-    json seri{};
-    seri["player"]["statistics"] = stats->to_json();
-    seri["player"]["platform"] = platform->to_json();
-    seri["player"]["balls_num"] = balls.size();
-    for (int i = 0; i < balls.size(); ++i) {
-        seri["player"]["balls"][i] = balls[i]->to_json();
-    } 
-    return seri;
+void Player::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("player");
+    writer.beginObject();
+    if (balls.size()) {
+        writer.key("balls");
+        writer.beginArray();
+        for (Ball* ball : balls) {
+            ball->to_json(writer);
+        }
+        writer.endArray();
+    }
+    writer.key("balls_num"); writer.value(balls.size());
+    writer.key("platform");
+    platform->to_json(writer);
+    writer.key("statistics");
+    stats->to_json(writer);
+    writer.endObject();
+    writer.endObject();
+}
+
+void Player::to_binary(std::string &buf) {
+    stats->to_binary(buf);
+    platform->to_binary(buf);
+    putRecord(buf, (uint32_t)balls.size());
+    for (Ball* ball : balls) {
+        ball->to_binary(buf);
+    }
 }
 
-SaveloadObject* Player::from_json(json &deri) {
-    Statistics* stats = new Statistics(0, 0, 0, "");
-    Platform* platform = new Platform(sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+SaveloadObject* Player::from_binary(const char* &cur) {
+    Statistics blankStats(0, 0, 0, "");
+    Platform blankPlatform(sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+    Ball blankBall(0, sf::Vector2f(0, 0), sf::Color::Black);
     std::vector <Ball*> balls;
-    int size = deri["player"]["balls_num"].get<int>();
-
-    stats = (Statistics*)stats->from_json(deri["player"]["statistics"]);
-    platform = (Platform*)platform->from_json(deri["player"]["platform"]);
-    for (int i = 0; i < size; ++i) {
-        Ball* ball = new Ball(0, sf::Vector2f(0, 0), sf::Color::Black);
-        ball = (Ball*)ball->from_json(deri["player"]["balls"][i]);
-        balls.push_back(ball);
+    Statistics* stats = (Statistics*)blankStats.from_binary(cur);
+    Platform* platform = (Platform*)blankPlatform.from_binary(cur);
+    uint32_t size = getRecord<uint32_t>(cur);
+    for (uint32_t i = 0; i < size; ++i) {
+        balls.push_back((Ball*)blankBall.from_binary(cur));
     }
     Player* player = new Player(stats, platform, balls);
     return player;
@@ -1106,6 +2865,12 @@ Statistics* Player::getStatistics() {
 
 Players::Players() {}
 
+Players::~Players() {
+    for (Player* player : players) {
+        delete player;
+    }
+}
+
 void Players::addPlayer(Player *player){
     players.push_back(player);
 }
@@ -1121,42 +2886,317 @@ void Players::to_string(std::stringstream &strStream) {
     }
 }
 
-SaveloadObject* Players::from_string(std::stringstream &strStream) {
-    std::string temp;
-    int size;
-    strStream >> temp >> temp >> size;
+SaveloadObject* Players::from_string(TextReader &reader) {
+    reader.expect("Players");
+    int size = reader.number<int>("PlayersNum");
     Players* players = new Players();
-    for (int i = 0; i < size; ++i) {
-        Player* player = new Player("");
-        player = (Player*)player->from_string(strStream);
-        players->addPlayer(player);
+    Player blank(nullptr, nullptr, {});
+    for (int i = 0; i < size && reader.ok(); ++i) {
+        players->addPlayer((Player*)blank.from_string(reader));
     }
     return players;
 }
 
-json Players::to_json() {
-    json seri{};
-    seri["players_num"] = players.size();
-    for (int i = 0; i < players.size(); ++i) {
-        seri["players"][i] = players[i]->to_json();
-    } 
-    return seri;
+void Players::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    if (players.size()) {
+        writer.key("players");
+        writer.beginArray();
+        for (Player* player : players) {
+            player->to_json(writer);
+        }
+        writer.endArray();
+    }
+    writer.key("players_num"); writer.value(players.size());
+    writer.endObject();
 }
 
-SaveloadObject* Players::from_json(json &deri) {
-    int size = deri["players_num"].get<int>();
+void Players::to_binary(std::string &buf) {
+    putRecord(buf, (uint32_t)players.size());
+    for (Player* player : players) {
+        player->to_binary(buf);
+    }
+}
+
+SaveloadObject* Players::from_binary(const char* &cur) {
+    uint32_t size = getRecord<uint32_t>(cur);
     Players* players = new Players();
-    for (int i = 0; i < size; ++i) {
-        Player* player = new Player("");
-        player = (Player*)player->from_json(deri["players"][i]);
-        players->addPlayer(player);
+    Player blank(nullptr, nullptr, {});
+    for (uint32_t i = 0; i < size; ++i) {
+        players->addPlayer((Player*)blank.from_binary(cur));
     }
     return players;
 }
 
-std::queue<Event> EventDispatcher::eventQueue, EventDispatcher::gameEventQueue;
+// The layout and the ball and platform are taken from a level and a player built at the current difficulty,
+// so boxes and speeds match a new game's to the bit
+FieldBatch::FieldBatch(int n, uint64_t seed) {
+    GameField level;
+    level.addLevel();
+    for (Obstacle* obstacle : level.getObstacles()) {
+        bricks.push_back(obstacle->getBound());
+        colors.push_back(obstacle->getColor());
+    }
+    if (level.getGrid()) {
+        for (size_t i = 0; i < level.getGrid()->getCells().size(); ++i) {
+            bricks.push_back(level.getGrid()->getCellBound(i));
+            colors.push_back(level.getGrid()->getColor());
+        }
+    }
+    columns = 1;
+    while (columns < bricks.size() && bricks[columns].top == bricks[0].top) columns++;
+    origin = sf::Vector2f(bricks[0].left, bricks[0].top);
+    pitch = sf::Vector2f(
+        columns > 1 ? bricks[1].left - bricks[0].left : Resolution::LW,
+        columns < bricks.size() ? bricks[columns].top - bricks[0].top : Resolution::LH
+    );
+    Player player("Batch");
+    ball = player.getBalls()[0]->getBound();
+    launch = player.getBalls()[0]->getVelocity();
+    platform = player.getPlatform()->getBound();
+    ballColor = player.getBalls()[0]->getColor();
+    platformColor = player.getPlatform()->getColor();
+    ceiling = sf::FloatRect(0, 0, Resolution::LW, Resolution::LH / 20);
+    boards = n;
+    words = (bricks.size() + 63) / 64;
+    ballX.resize(n);
+    ballY.resize(n);
+    velX.resize(n);
+    velY.resize(n);
+    platformX.resize(n);
+    lives.resize(n);
+    score.resize(n);
+    alive.resize(n);
+    cells.resize(n * words);
+    random.resize(n);
+    reset(seed);
+}
+
+void FieldBatch::reset(uint64_t seed) {
+    for (int i = 0; i < boards; ++i) {
+        random[i] = seed + i * 0x9e3779b97f4a7c15ull;
+        restart(i);
+    }
+}
+
+void FieldBatch::restart(int board) {
+    ballX[board] = ball.left;
+    ballY[board] = ball.top;
+    velX[board] = launch.x;
+    velY[board] = launch.y;
+    platformX[board] = platform.left;
+    lives[board] = 3;
+    score[board] = 0;
+    alive[board] = bricks.size();
+    for (int w = 0; w < words; ++w) {
+        cells[board * words + w] = w + 1 < words || bricks.size() % 64 == 0 ? ~0ull : (1ull << bricks.size() % 64) - 1;
+    }
+}
+
+// splitmix64 per board, standing in for the field's mt19937_64 so a board's state stays one word
+float FieldBatch::draw(int board) {
+    uint64_t z = (random[board] += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return (float)((z ^ (z >> 31)) >> 40) / (1 << 24);
+}
+
+void FieldBatch::bounce(int board, bool horizontal) {
+    const PhysicsConstants &physics = Physics::get();
+    float &vx = velX[board], &vy = velY[board];
+    ballX[board] -= vx;
+    ballY[board] -= vy;
+    vy /= fabs(vy);
+    vx /= fabs(vx);
+    if (horizontal) {
+        vy = -vy;
+    } else {
+        vx = -vx;
+    }
+    vy *= (draw(board) * 0.3 + 0.5) * physics.ballSpeedRoot;
+    vx *= sqrt(physics.ballSpeed - vy * vy);
+}
+
+// Detection runs on the moved positions and every hit is queued before any is handled, as in GameField::update.
+// The overlap test is DisplayObject::checkCollision's, ties included
+void FieldBatch::step_all(const int* actions, float* rewards, int* dones) {
+    float platformSpeed = Physics::get().platformSpeed;
+    for (int i = 0; i < boards; ++i) {
+        ballX[i] += velX[i];
+        ballY[i] += velY[i];
+        platformX[i] += platformSpeed * ((actions[i] > 0) - (actions[i] < 0));
+    }
+    int hits[8];
+    bool kinds[8];
+    for (int i = 0; i < boards; ++i) {
+        int before = score[i], livesBefore = lives[i], found = 0;
+        uint64_t* row = &cells[i * words];
+        sf::FloatRect own(ballX[i], ballY[i], ball.width, ball.height);
+        auto overlap = [&own, &kinds, &found](const sf::FloatRect &obj) {
+            float ownRight = own.left + own.width, objRight = obj.left + obj.width;
+            float ownBottom = own.top + own.height, objBottom = obj.top + obj.height;
+            if (!(objRight > own.left && ownRight >= obj.left && objBottom > own.top && ownBottom >= obj.top)) return false;
+            kinds[found] = std::min(ownRight, objRight) - std::max(own.left, obj.left) >= std::min(ownBottom, objBottom) - std::max(own.top, obj.top);
+            return true;
+        };
+        if (overlap(sf::FloatRect(platformX[i], platform.top, platform.width, platform.height))) hits[found++] = -1;
+        int c0 = std::max(0, (int)floor((own.left - origin.x) / pitch.x) - 1);
+        int c1 = std::min(columns - 1, (int)floor((own.left + own.width - origin.x) / pitch.x) + 1);
+        int r0 = std::max(0, (int)floor((own.top - origin.y) / pitch.y) - 1);
+        int r1 = std::min((int)(bricks.size() / columns) - 1, (int)floor((own.top + own.height - origin.y) / pitch.y) + 1);
+        for (int r = r0; r <= r1 && found < 6; ++r) {
+            for (int c = c0; c <= c1 && found < 6; ++c) {
+                int cell = r * columns + c;
+                if (row[cell / 64] >> (cell % 64) & 1 && overlap(bricks[cell])) hits[found++] = cell;
+            }
+        }
+        if (overlap(ceiling)) hits[found++] = -1;
+        bool wall = own.left < 0 || own.left + own.width > Resolution::LW;
+        bool fall = own.top + own.height > Resolution::LH;
+        // The platform's bounce off a wall was queued first
+        if (platformX[i] < 0) {
+            platformX[i] = 0;
+        } else if (platformX[i] + platform.width > Resolution::LW) {
+            platformX[i] = Resolution::LW - platform.width;
+        }
+        for (int k = 0; k < found; ++k) {
+            bounce(i, kinds[k]);
+            if (hits[k] < 0) continue;
+            row[hits[k] / 64] &= ~(1ull << hits[k] % 64);
+            score[i] += 10;
+            alive[i]--;
+        }
+        if (wall) bounce(i, false);
+        if (fall) {
+            ballX[i] = ball.left;
+            ballY[i] = ball.top;
+            platformX[i] = platform.left;
+            lives[i]--;
+        }
+        rewards[i] = (score[i] - before) / 10 - (livesBefore - lives[i]);
+        dones[i] = alive[i] == 0 || lives[i] <= 0;
+        if (dones[i]) restart(i);
+    }
+}
+
+// Draws a board as its field would be, minus the status bar, which is as black as the background
+void FieldBatch::render(int board, Canvas &canvas) {
+    canvas.clear(sf::Color::Black);
+    const uint64_t* own = cells.data() + (size_t)board * words;
+    for (int k = 0; k < (int)bricks.size(); ++k) {
+        if (own[k / 64] >> (k % 64) & 1) canvas.fillRect(bricks[k], colors[k]);
+    }
+    canvas.fillRect(sf::FloatRect(platformX[board], platform.top, platform.width, platform.height), platformColor);
+    canvas.fillCircle(sf::FloatRect(ballX[board], ballY[board], ball.width, ball.height), ballColor);
+}
+
+// Steps n boards under a policy that chases the ball and reports board steps per second on this core
+void FieldBatch::benchmark(int n) {
+    FieldBatch batch(n, 1);
+    std::vector<int> actions(n), dones(n);
+    std::vector<float> rewards(n);
+    long long steps = 0, finished = 0;
+    sf::Clock clock;
+    while (clock.getElapsedTime().asSeconds() < 2) {
+        for (int k = 0; k < 100; ++k) {
+            for (int i = 0; i < n; ++i) {
+                float offset = batch.ballX[i] + batch.ball.width / 2 - batch.platformX[i] - batch.platform.width / 2;
+                actions[i] = (offset > batch.platform.width / 4) - (offset < -batch.platform.width / 4);
+            }
+            batch.step_all(actions.data(), rewards.data(), dones.data());
+            for (int i = 0; i < n; ++i) {
+                finished += dones[i];
+            }
+        }
+        steps += 100ll * n;
+    }
+    float seconds = clock.getElapsedTime().asSeconds();
+    std::cout << n << " boards of " << batch.getBricks() << " bricks: " << (long long)(steps / seconds) << " board steps per second, "
+              << finished << " rounds finished\n";
+}
+
+std::mutex Profiler::mutex;
+std::vector<ProfileRing*> Profiler::rings;
+std::atomic<bool> Profiler::requested{false};
+
+// Rings outlive their threads, so an export still shows what a finished thread did
+ProfileRing* Profiler::ring() {
+    thread_local ProfileRing* own = nullptr;
+    if (own) return own;
+    std::lock_guard<std::mutex> lock(mutex);
+    own = new ProfileRing();
+    own->thread = rings.size() + 1;
+    rings.push_back(own);
+    return own;
+}
+
+uint64_t Profiler::now() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char* name, uint64_t start) {
+    ProfileRing* own = ring();
+    uint64_t head = own->head.load(std::memory_order_relaxed);
+    ProfileRecord &slot = own->records[head % Profiling::PF_RING];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(now(), std::memory_order_relaxed);
+    own->head.store(head + 1, std::memory_order_release);
+}
+
+#ifdef ARCANOID_PROFILE
+// Chrome trace_event format: one complete event per zone, which the viewer nests by time within a thread
+std::string Profiler::exportTrace() {
+    std::vector<ProfileRing*> all;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        all = rings;
+    }
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("displayTimeUnit");
+    writer.value(std::string("ms"));
+    writer.key("traceEvents");
+    writer.beginArray();
+    for (ProfileRing* ring : all) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = head > Profiling::PF_RING ? head - Profiling::PF_RING : 0;
+        std::vector<std::tuple<const char*, uint64_t, uint64_t>> copied;
+        copied.reserve(head - first);
+        for (uint64_t i = first; i < head; ++i) {
+            ProfileRecord &slot = ring->records[i % Profiling::PF_RING];
+            copied.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring->head.load(std::memory_order_relaxed);
+        // The writer may be filling slot after % PF_RING, so the record at after - PF_RING is as good as overwritten
+        size_t stale = after >= first + Profiling::PF_RING ? std::min<uint64_t>(after - first - Profiling::PF_RING + 1, copied.size()) : 0;
+        for (size_t i = stale; i < copied.size(); ++i) {
+            writer.beginObject();
+            writer.key("name"); writer.value(std::string(std::get<0>(copied[i])));
+            writer.key("ph"); writer.value(std::string("X"));
+            writer.key("ts"); writer.value(std::get<1>(copied[i]) / 1000.0);
+            writer.key("dur"); writer.value((std::get<2>(copied[i]) - std::get<1>(copied[i])) / 1000.0);
+            writer.key("pid"); writer.value(1);
+            writer.key("tid"); writer.value(ring->thread);
+            writer.endObject();
+        }
+    }
+    writer.endArray();
+    writer.endObject();
+    return out;
+}
+#endif
+
+std::queue<Event> EventDispatcher::eventQueue;
+thread_local std::queue<Event> EventDispatcher::gameEventQueue;
+std::mutex EventDispatcher::mutex;
 
+// Game events may also come from the save writer thread, game field events stay on the thread stepping the field
 void EventDispatcher::setEvent(Event e) {
+    std::lock_guard<std::mutex> lock(EventDispatcher::mutex);
     EventDispatcher::eventQueue.push(e);
 }
 
@@ -1165,6 +3205,7 @@ void EventDispatcher::setGameEvent(Event e) {
 }
 
 bool EventDispatcher::pollEvent(Event &e) {
+    std::lock_guard<std::mutex> lock(EventDispatcher::mutex);
     if (EventDispatcher::eventQueue.empty()) return false;
     e = EventDispatcher::eventQueue.front();
     EventDispatcher::eventQueue.pop();
@@ -1180,20 +3221,56 @@ bool EventDispatcher::pollGameEvent(Event &e) {
 
 Game::Game() {}
 
+// The field goes first, its status bar with it, then the players whose balls and platforms it pointed at
+Game::~Game() {
+    if (gameField) delete gameField->getBoard();
+    delete gameField;
+    delete sessionPlayers;
+    delete settings;
+    delete history;
+    delete settingsMenu;
+    delete pauseMenu;
+    delete slotsMenu;
+    delete start;
+    delete win;
+    delete lose;
+    delete window;
+}
+
 void Game::eventHandler(Event e) {
     switch(e.type) {
         case EventType::FRAME:
             update();
             break;
         case EventType::SAVE:
-            save(toSave);
-            save_json(toSave);
+            // Slots are always written whole so their text and json exports match the image; deltas are the journal's
+            writer.post({slotName(slot), SaveJobKind::SJ_EXPORT, history->to_binary(toSave), EventType::SAVE_DONE, EventType::SAVE_FAILED, slotHeader(Settings::getDiff(), sessionPlayers, gameField)});
+            pauseMenu->getButton(2)->setText("Saving...");
+            break;
+        case EventType::SAVE_DONE:
+            pauseMenu->getButton(2)->setText("Saved");
+            break;
+        case EventType::SAVE_FAILED:
+            pauseMenu->getButton(2)->setText("Save failed");
+            break;
+        case EventType::AUTOSAVE_DONE:
+            break;
+        case EventType::AUTOSAVE_FAILED:
+            journal.dropDeltas();
+            break;
+        case EventType::TRACE_DONE:
+            std::cout << "Trace written\n";
+            break;
+        case EventType::TRACE_FAILED:
+            std::cout << "Trace could not be written\n";
             break;
         case EventType::WIN:
+            discardJournal();
             init();
             state = Active::MESSAGE_WIN;
             break;
         case EventType::LOSE:
+            discardJournal();
             init();
             state = Active::MESSAGE_LOSE;
             break;
@@ -1208,7 +3285,6 @@ void Game::eventHandler(Event e) {
             break;
         case EventType::TO_GAME:
             gameField->getData()->getClock()->restart();
-            gameField->startTimers();
             state = Active::GAME;
             break;
         /**
@@ -1219,24 +3295,52 @@ void Game::eventHandler(Event e) {
         case EventType::TO_MENU:
             if (state == Active::GAME) {
                 gameField->getData()->setDelay(gameField->getData()->getClock()->getElapsedTime().asSeconds());
-                gameField->freezeTimers();
             }
             state = Active::MENU;
             break;
         case EventType::LOAD:      
-            load();
-            // load_json();
-            window->close();
-            create();
+            {
+            sf::Clock clock;
+            writer.flush();
+            load_binary(slotName(slot));
+            // load_json(slotName(slot));
+            std::stringstream latency;
+            latency << "Loaded in " << std::fixed << std::setprecision(1) << clock.getElapsedTime().asMicroseconds() / 1000.0 << " ms\n";
+            std::cout << latency.str();
+            }
+            break;
+        case EventType::TO_SAVE_SLOTS:
+        case EventType::TO_LOAD_SLOTS:
+            savingSlot = e.type == EventType::TO_SAVE_SLOTS;
+            slotsMenu->setTitle(savingSlot ? "Save" : "Load");
+            readSlots();
+            state = Active::SLOTS;
+            break;
+        case EventType::SLOT:
+            {
+            int chosen = 0;
+            while (chosen < SaveFormat::SF_SLOTS && slotsMenu->getButton(chosen) != e.obj) chosen++;
+            SlotHeader header;
+            if (chosen == SaveFormat::SF_SLOTS || (!savingSlot && !readSlotHeader(slotName(chosen), header))) break;
+            slot = chosen;
+            state = Active::MENU;
+            eventHandler({savingSlot ? EventType::SAVE : EventType::LOAD, nullptr});
+            }
+            break;
+        case EventType::REWIND:
+            // A rewind can take back a released bonus, which deltas cannot express
+            if (gameField->rewind(1)) journal.dropDeltas();
             break;
         case EventType::TO_SETTINGS:
             state = Active::SETTINGS;
             break;
         case EventType::NEW_GAME:
+            discardJournal();
             init();
             state = Active::MESSAGE_START;
             break;
         case EventType::QUIT:
+            discardJournal();
             window->close();
             break;
             ///!!!
@@ -1296,9 +3400,8 @@ void Game::eventHandler(Event e) {
                 settings->setResolution("1920x1000");
                 break;
             }
-            window->close();
-            create();
-            reinit();
+            settingsMenu->getButton(1)->setText(Settings::getResolutionStr());
+            resize();
             state = Active::SETTINGS;
             break;
             }
@@ -1308,20 +3411,38 @@ void Game::eventHandler(Event e) {
 void Game::update() {
     sf::Event e;
     bool pressed = false; 
-    while (window->pollEvent(e)) {
-        if (e.type == sf::Event::Closed) {
-            window->close();
-        }
-        if (e.type == sf::Event::MouseButtonReleased) {
-            pressed = true;
+    {
+        PROFILE_ZONE("poll window");
+        while (window->pollEvent(e)) {
+            if (e.type == sf::Event::Closed) {
+                discardJournal();
+                window->close();
+            }
+            if (e.type == sf::Event::MouseButtonReleased) {
+                pressed = true;
+            }
+            if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::R && state == Active::GAME) {
+                EventDispatcher::setEvent({EventType::REWIND, nullptr});
+            }
+#ifdef ARCANOID_PROFILE
+            if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::F12) {
+                Profiler::request();
+            }
+#endif
         }
     }
-    Event ev;
-    while (EventDispatcher::pollEvent(ev)) {
-        eventHandler(ev);
+#ifdef ARCANOID_PROFILE
+    if (Profiler::takeRequest()) dumpTrace();
+#endif
+    {
+        PROFILE_ZONE("dispatch");
+        Event ev;
+        while (EventDispatcher::pollEvent(ev)) {
+            eventHandler(ev);
+        }
     }
     // window->clear();
-    sf::Vector2i mousePos = sf::Mouse::getPosition(*window);
+    sf::Vector2i mousePos = sf::Vector2i(window->mapPixelToCoords(sf::Mouse::getPosition(*window)));
     switch (state) {
         case Active::MESSAGE_LOSE:
             lose->update(mousePos, pressed);
@@ -1350,9 +3471,15 @@ void Game::update() {
             gameField->draw(*window);
             settingsMenu->draw(*window);
             break;
+        case Active::SLOTS:
+            slotsMenu->update(mousePos, pressed);
+            gameField->draw(*window);
+            slotsMenu->draw(*window);
+            break;
         case Active::GAME:
             gameField->update(mousePos, pressed);
             gameField->draw(*window);
+            autosave();
             break;
         /**
         case Active::PAUSE:
@@ -1361,6 +3488,7 @@ void Game::update() {
             break;
         */
     }
+    PROFILE_ZONE("display");
     window->display();
 }
 
@@ -1382,10 +3510,25 @@ void Game::create() {
         );
     }
     window->setKeyRepeatEnabled(false);
+    window->setView(sf::View(sf::FloatRect(0, 0, Resolution::LW, Resolution::LH)));
+    layout = Settings::getResolution();
+}
+
+// The view keeps the logical extent, so a new resolution only resizes the window;
+// SFML can toggle fullscreen only by recreating it
+void Game::resize() {
+    if (!window || layout == Settings::getResolution()) return;
+    if (layout.first == Resolution::FW || Settings::getResolution().first == Resolution::FW) {
+        window->close();
+        create();
+        return;
+    }
+    window->setSize(sf::Vector2u(Settings::getResolution().first, Settings::getResolution().second));
+    layout = Settings::getResolution();
 }
 
 void Game::initMenus() {
-    sf::Vector2f fullResolution = sf::Vector2f(Settings::getResolution().first, Settings::getResolution().second);
+    sf::Vector2f fullResolution = sf::Vector2f(Resolution::LW, Resolution::LH);
     sf::Vector2f buttonSize = sf::Vector2f(fullResolution.x / 5, fullResolution.y / 20);
     float delta = fullResolution.y / 20;
     sf::Vector2f menuSize = sf::Vector2f(fullResolution.x / 3, fullResolution.y - 2 * delta);
@@ -1412,181 +3555,255 @@ void Game::initMenus() {
     std::vector<Button*> pause_buttons;
     pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos), sf::Color::Blue, "Continue", EventType::START));
     pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 2), sf::Color::Blue, "New Game", EventType::NEW_GAME)); // Name changed
-    pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 3), sf::Color::Blue, "Save", EventType::SAVE));
-    pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 4), sf::Color::Blue, "Load", EventType::LOAD));
+    pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 3), sf::Color::Blue, "Save", EventType::TO_SAVE_SLOTS));
+    pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 4), sf::Color::Blue, "Load", EventType::TO_LOAD_SLOTS));
     pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 5), sf::Color::Blue, "Settings", EventType::TO_SETTINGS)); // Added new line
     pause_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * 6), sf::Color::Blue, "Exit", EventType::QUIT)); // Name and event changed
     pauseMenu = new Menu(menuSize, sf::Color(0, 0, 0, 0), pause_buttons, "Menu"); // Changed sizes and name
 
+    sf::Vector2f slotSize = sf::Vector2f(fullResolution.x * 2 / 3, fullResolution.y / 20);
+    std::vector<Button*> slot_buttons;
+    for (int i = 0; i < SaveFormat::SF_SLOTS; ++i) {
+        slot_buttons.push_back(new Button(slotSize, sf::Vector2f((fullResolution.x - slotSize.x) / 2, delta + yPos * (i + 1)), sf::Color::Blue, "", EventType::SLOT));
+    }
+    slot_buttons.push_back(new Button(buttonSize, sf::Vector2f(xPos, delta + yPos * (SaveFormat::SF_SLOTS + 1)), sf::Color::Blue, "Return to menu", EventType::TO_MENU));
+    slotsMenu = new Menu(menuSize, sf::Color(0, 0, 0, 0), slot_buttons, "Slots");
+
     start = new MessageBox(EventType::TO_GAME, "Press the button to start/continue the game session", boxSize);
     win = new MessageBox(EventType::TO_MENU, "You destroyed all obstacles on your way! You won!", boxSize);
     lose = new MessageBox(EventType::TO_MENU, "You lost too many lives ans you died. You lost", boxSize);
 }
 
-void Game::reinit() {
-    GameField* newGameField = new GameField();
+// Settings and players load as new objects and the field in place; the objects they replace are freed
+// once the field holds the loaded players instead
+void Game::attachLoaded() {
+    history->migrate(toSave);
+    Settings* replacedSettings = settings;
+    Players* replacedPlayers = sessionPlayers;
+    settings = (Settings*)toSave[SaveSectionId::SS_SETTINGS];
+    settings->apply();
 
-    sessionPlayers = new Players();
-    sessionPlayers->addPlayer(new Player("Artur"));
+    sessionPlayers = (Players*)toSave[SaveSectionId::SS_PLAYERS];
 
-    initMenus();
+    // Menus and the status bar live in logical space, so a load only relabels them and resizes the window
+    settingsMenu->getButton(0)->setText(Settings::getDiffStr());
+    settingsMenu->getButton(1)->setText(Settings::getResolutionStr());
+    pauseMenu->getButton(2)->setText("Save");
+    resize();
+
+    gameField = (GameField*)toSave[SaveSectionId::SS_FIELD];
+    gameField->setRewind(rewindTicks, rewindDepth);
     for (Player* player : sessionPlayers->getPlayers()) {
-        newGameField->addItem((Platform*)player->getPlatform());
+        gameField->addItem((Platform*)player->getPlatform());
         for (Ball* ball : player->getBalls()) {
-             newGameField->addItem((Ball*)ball);
+             gameField->addItem((Ball*)ball);
         }
-        newGameField->addItem((Statistics*)player->getStatistics());
+        gameField->addItem((Statistics*)player->getStatistics());
     }
 
-    std::vector <Obstacle*> blocks;
-    sf::Vector2f fullResolution = sf::Vector2f(Settings::getResolution().first, Settings::getResolution().second);
-    int rowNum = ObstacleNum::OB_ROW / (6.5 - Settings::getDiff());
-    int columnNum = ObstacleNum::OB_COLUMN / (6.5 - Settings::getDiff());
-    float gapWidth = (float)fullResolution.x / columnNum / 20;
-    float gapHeight = (float)(fullResolution.y - fullResolution.y / 20) / 2 / rowNum / 10;
-    float obstacleWidth = (float)fullResolution.x / columnNum - gapWidth * 2;
-    float obstacleHeight = (float)(fullResolution.y - fullResolution.y / 20) / 2 / rowNum - gapHeight * 2;
-    sf::Vector2f obstacleSize = sf::Vector2f(obstacleWidth, obstacleHeight);
-    for (int h = 0; h < rowNum; ++h) {
-        for (int w = 0; w < columnNum; ++w) {
-            blocks.push_back(new Obstacle(
-                obstacleSize,
-                sf::Vector2f((gapWidth + obstacleWidth) * w + gapWidth * (w + 1), (gapHeight + obstacleHeight) * h + gapHeight * (h + 1) + fullResolution.y / 20),
-                sf::Color::Yellow
-            ));
-        }
-    }
-    int i = 0;
-    for (Obstacle* block : blocks) {
-        block->clearBonuses();
-        block->setColor(sf::Color::Yellow);
-        while (!dynamic_cast<Obstacle*>(gameField->getObjects()[i])) i++;
-        std::vector<Bonus*> bonuses = ((Obstacle*)(gameField->getObjects()[i]))->getBonuses();
-        i++;
-        if (bonuses.size() > 0) {
-            //block->setColor(sf::Color::Green);
-            for (Bonus* bonus : bonuses) {
-                Bonus* resizedBonus = new Bonus(sf::Vector2f(block->getBound().width, block->getBound().height), sf::Vector2f(block->getBound().left, block->getBound().top), (float)BonusSpeed::BSSP_MEDIUM);
-                resizedBonus->setBonus(bonus->getBonus());
-                block->addBonus(resizedBonus);
-            }
-        }
-        newGameField->addItem((DisplayObject*)block);
+    if (!gameField->getBoard()) {
+        gameField->addItem(new StatusBar(
+            sf::Vector2f(Resolution::LW, Resolution::LH / 20), 
+            gameField->getData()
+        ));
+    } else {
+        gameField->addItem(gameField->getBoard());
     }
+    if (replacedSettings != settings) delete replacedSettings;
+    if (replacedPlayers != sessionPlayers) delete replacedPlayers;
 
-    newGameField->addItem(new StatusBar(
-        sf::Vector2f(fullResolution.x, fullResolution.y / 20), 
-        newGameField->getData()
-    ));
-
-    gameField = newGameField;
-
+    journal.dropDeltas();
     toSave.clear();
     toSave.push_back(settings);
     toSave.push_back(sessionPlayers);
     toSave.push_back(gameField);
 }
 
-void Game::load() {
-    std::string filename = "save.txt";
-    struct stat stat_buf;
-    int rc = stat(filename.c_str(), &stat_buf);
-    if (stat_buf.st_size == 0) {
+void Game::load(const std::string &name) {
+    MappedFile file(name + ".txt");
+    if (file.getSize() == 0) {
         init();
         state = Active::MENU;
         return;
     }
-    std::stringstream strStream;
-    inFile.open(filename);
-    strStream << inFile.rdbuf();
-    inFile.close();
+    TextReader reader(file.getData(), file.getSize());
+    if (!history->from_string(toSave, reader)) {
+        std::cerr << name << ".txt: " << reader.error() << '\n';
+        init();
+        state = Active::MENU;
+        return;
+    }
+    attachLoaded();
+}
 
-    history->from_string(toSave, strStream);
+void Game::load_json(const std::string &name) {
+    MappedFile file(name + ".json");
+    if (!history->from_json(toSave, file.getData(), file.getSize())) {
+        init();
+        state = Active::MENU;
+        return;
+    }
+    attachLoaded();
+}
 
-    settings = (Settings*)toSave[0];
-    history = new Proxy();
+void Game::load_binary(const std::string &name) {
+    if (!load_chain(name)) load(name);
+}
 
-    sessionPlayers = (Players*)toSave[1];
+bool Game::load_chain(const std::string &name) {
+    MappedFile file(name + ".bin");
+    if (!history->from_binary(toSave, file.getData(), file.getSize())) return false;
+    MappedFile log(name + ".delta");
+    history->from_delta(toSave, log.getData(), log.getSize());
+    attachLoaded();
+    return true;
+}
 
-    initMenus();
-    
-    gameField = (GameField*)toSave[2];
-    for (Player* player : sessionPlayers->getPlayers()) {
-        gameField->addItem((Platform*)player->getPlatform());
-        for (Ball* ball : player->getBalls()) {
-             gameField->addItem((Ball*)ball);
+// Resumes the session the autosave journal last recorded, if the previous run did not end it
+bool Game::recover() {
+    if (!load_chain("autosave")) return false;
+    state = Active::MESSAGE_START;
+    return true;
+}
+
+void Game::save_chain(const std::string &name, Proxy* chain, SaveJobKind full, EventType done, EventType failed, const std::string &header) {
+    std::string delta = chain->to_delta(toSave);
+    if (delta.empty()) {
+        writer.post({name, full, chain->to_binary(toSave), done, failed, header});
+    } else {
+        writer.post({name, SaveJobKind::SJ_APPEND, delta, done, failed, header});
+    }
+}
+
+// Only the fixed-size headers are read, so opening the menu costs the same whatever the saves hold
+void Game::readSlots() {
+    for (int i = 0; i < SaveFormat::SF_SLOTS; ++i) {
+        std::stringstream label;
+        label << "Slot " << i + 1 << ": ";
+        SlotHeader header;
+        if (writer.pending(slotName(i))) {
+            label << "saving...";
+        } else if (!readSlotHeader(slotName(i), header)) {
+            label << "empty";
+        } else {
+            int seconds = header.time;
+            label << header.name << ", score " << header.score << ", lives " << header.lives << ", " << seconds / 60 << ':' << std::setfill('0') << std::setw(2) << seconds % 60;
+            label << ", " << Settings::getDiffStr((Difficulty)header.difficulty) << ", #" << std::hex << std::setw(8) << header.thumbnail;
         }
-        gameField->addItem((Statistics*)player->getStatistics());
+        slotsMenu->getButton(i)->setText(label.str());
     }
+}
 
-    gameField->addItem(new StatusBar(
-        sf::Vector2f(Settings::getResolution().first, Settings::getResolution().second / 20), 
-        gameField->getData()
-    ));
+void Game::setRewind(int ticks, int depth) {
+    rewindTicks = ticks;
+    rewindDepth = depth;
+}
 
-    toSave.clear();
-    toSave.push_back(settings);
-    toSave.push_back(sessionPlayers);
-    toSave.push_back(gameField);
+void Game::setAutosave(int ticks, size_t cap) {
+    autosaveTicks = ticks;
+    autosaveCountdown = ticks;
+    journal.setLimit(cap);
 }
 
-void Game::load_json() {
-    std::string filename = "save.json";
-    struct stat stat_buf;
-    int rc = stat(filename.c_str(), &stat_buf);
-    if (stat_buf.st_size == 0) {
-        init();
-        state = Active::MENU;
-        return;
-    }
-    json deri{};
-    std::stringstream strStream;
-    inFile.open(filename);
-    strStream << inFile.rdbuf();
-    inFile.close();
-    std::string str = strStream.str();
-    deri = json::parse(str);
-    history->from_json(toSave, deri);
-
-    settings = (Settings*)toSave[0];
-    history = new Proxy();
+// Skipped while the previous journal write is still in flight, so a slow disk never queues more than one record,
+// and once the window is closed, so the frame that quits cannot bring back the journal it discarded
+void Game::autosave() {
+    PROFILE_ZONE("autosave");
+    if (!autosaveTicks || !window->isOpen() || --autosaveCountdown > 0 || writer.pending("autosave")) return;
+    autosaveCountdown = autosaveTicks;
+    save_chain("autosave", &journal, SaveJobKind::SJ_FULL, EventType::AUTOSAVE_DONE, EventType::AUTOSAVE_FAILED, "");
+}
+
+void Game::discardJournal() {
+    journal.dropDeltas();
+    writer.post({"autosave", SaveJobKind::SJ_DISCARD, "", EventType::AUTOSAVE_DONE, EventType::AUTOSAVE_FAILED});
+}
 
-    sessionPlayers = (Players*)toSave[1];
+void Game::save(std::vector<SaveloadObject *> toSave, const std::string &name) {
+    writeFile(name + ".txt", history->to_string(toSave) + '\n');
+}
 
-    initMenus();
-    
-    gameField = (GameField*)toSave[2];
-    for (Player* player : sessionPlayers->getPlayers()) {
-        gameField->addItem((Platform*)player->getPlatform());
-        for (Ball* ball : player->getBalls()) {
-             gameField->addItem((Ball*)ball);
+void Game::save_json(std::vector<SaveloadObject *> toSave, const std::string &name) {
+    writeFile(name + ".json", history->dump_json(toSave) + '\n');
+}
+
+void Game::save_binary(std::vector<SaveloadObject *> toSave, const std::string &name) {
+    if (writeFile(name + ".bin", history->to_binary(toSave))) unlink((name + ".delta").c_str());
+}
+
+// Saves and loads bench.* files, which are removed afterwards, so the player's slots are never touched
+void Game::benchmark(int rounds) {
+    init();
+    std::vector<std::pair<std::string, std::string>> formats = {{"text", "bench.txt"}, {"json", "bench.json"}, {"binary", "bench.bin"}};
+    for (std::pair<std::string, std::string> &format : formats) {
+        sf::Clock clock;
+        for (int i = 0; i < rounds; ++i) {
+            if (format.first == "text") save(toSave, "bench");
+            if (format.first == "json") save_json(toSave, "bench");
+            if (format.first == "binary") save_binary(toSave, "bench");
         }
-        gameField->addItem((Statistics*)player->getStatistics());
+        float saveTime = clock.restart().asSeconds() * 1000 / rounds;
+        for (int i = 0; i < rounds; ++i) {
+            if (format.first == "text") load("bench");
+            if (format.first == "json") load_json("bench");
+            if (format.first == "binary") load_binary("bench");
+        }
+        float loadTime = clock.restart().asSeconds() * 1000 / rounds;
+        struct stat stat_buf;
+        stat(format.second.c_str(), &stat_buf);
+        std::cout << std::left << std::setw(8) << format.first << std::setw(10) << stat_buf.st_size << "bytes  save " << saveTime << " ms  load " << loadTime << " ms\n";
+        unlink(format.second.c_str());
     }
+}
 
-    gameField->addItem(new StatusBar(
-        sf::Vector2f(Settings::getResolution().first, Settings::getResolution().second / 20), 
-        gameField->getData()
-    ));
-
-    toSave.clear();
-    toSave.push_back(settings);
-    toSave.push_back(sessionPlayers);
-    toSave.push_back(gameField);
+// Plays round after round without a window, with the autopilot unless another provider was set. A finished round
+// is rewound to the first tick and its bonuses rerolled, so the same session is played throughout
+void Game::soak(long long ticks) {
+    static Autopilot autopilot;
+    if (!input) input = &autopilot;
+    init();
+    // Restoring the first tick frees the round's bonuses, which the rewind ring would still point at
+    gameField->setRewind(0, 0);
+    FieldSnapshot start;
+    gameField->snapshot(start);
+    long long rounds[2] = {0, 0}, score = 0;
+    sf::Clock clock;
+    for (long long played = 0; played < ticks; ++played) {
+        gameField->update(sf::Vector2i(0, 0), false);
+        Event e;
+        while (EventDispatcher::pollEvent(e)) {
+            if (e.type != EventType::WIN && e.type != EventType::LOSE) continue;
+            rounds[e.type == EventType::WIN]++;
+            score += gameField->getData()->getScore();
+            gameField->restore(start);
+            gameField->reseed(rounds[0] + rounds[1]);
+        }
+#ifdef ARCANOID_PROFILE
+        if (Profiler::takeRequest()) dumpTrace();
+#endif
+    }
+    float seconds = clock.getElapsedTime().asSeconds();
+    std::cout << ticks << " ticks in " << seconds << " s (" << (long long)(ticks / std::max(seconds, 1e-6f)) << " per second), "
+              << rounds[1] << " won, " << rounds[0] << " lost, average score " << (rounds[0] + rounds[1] ? score / (rounds[0] + rounds[1]) : 0) << '\n';
+#ifdef ARCANOID_PROFILE
+    dumpTrace();
+#endif
+    writer.flush();
 }
 
-void Game::save(std::vector<SaveloadObject *> toSave) {
-    std::string seri = history->to_string(toSave);
-    outFile.open("save.txt");
-    outFile << seri << '\n';
-    outFile.close();
+#ifdef ARCANOID_PROFILE
+// Each dump goes to its own file, formatted here and written by the save thread
+void Game::dumpTrace() {
+    static int dumps = 0;
+    writer.post({"trace-" + std::to_string(++dumps) + ".json", SaveJobKind::SJ_TRACE, Profiler::exportTrace(), EventType::TRACE_DONE, EventType::TRACE_FAILED});
 }
+#endif
 
-void Game::save_json(std::vector<SaveloadObject *> toSave) {
-    json seri = history->to_json(toSave);
-    outFile.open("save.json");
-    outFile << std::setw(4) << seri << '\n';
-    outFile.close();
+bool Game::screenshot(const std::string &filename, int width, int height) {
+    std::vector<uint8_t> frame((size_t)width * height * 4);
+    Canvas canvas(frame.data(), width, height, 4);
+    gameField->rasterize(canvas);
+    return canvas.save(filename);
 }
 
 void Game::init() {
@@ -1601,6 +3818,8 @@ void Game::init() {
     initMenus();
     
     gameField = new GameField();
+    gameField->setRewind(rewindTicks, rewindDepth);
+    if (input) gameField->setInput(input);
     for (Player* player : sessionPlayers->getPlayers()) {
         gameField->addItem((Platform*)player->getPlatform());
         for (Ball* ball : player->getBalls()) {
@@ -1609,33 +3828,14 @@ void Game::init() {
         gameField->addItem((Statistics*)player->getStatistics());
     }
 
-    std::vector <Obstacle*> blocks;
-    sf::Vector2f fullResolution = sf::Vector2f(Settings::getResolution().first, Settings::getResolution().second);
-    int rowNum = ObstacleNum::OB_ROW / (6.5 - Settings::getDiff());
-    int columnNum = ObstacleNum::OB_COLUMN / (6.5 - Settings::getDiff());
-    float gapWidth = (float)fullResolution.x / columnNum / 20;
-    float gapHeight = (float)(fullResolution.y - fullResolution.y / 20) / 2 / rowNum / 10;
-    float obstacleWidth = (float)fullResolution.x / columnNum - gapWidth * 2;
-    float obstacleHeight = (float)(fullResolution.y - fullResolution.y / 20) / 2 / rowNum - gapHeight * 2;
-    sf::Vector2f obstacleSize = sf::Vector2f(obstacleWidth, obstacleHeight);
-    for (int h = 0; h < rowNum; ++h) {
-        for (int w = 0; w < columnNum; ++w) {
-            blocks.push_back(new Obstacle(
-                obstacleSize,
-                sf::Vector2f((gapWidth + obstacleWidth) * w + gapWidth * (w + 1), (gapHeight + obstacleHeight) * h + gapHeight * (h + 1) + fullResolution.y / 20),
-                sf::Color::Yellow
-            ));
-        }
-    }
-    for (Obstacle* block : blocks) {
-        gameField->addItem((DisplayObject*)block);
-    }
+    gameField->addLevel();
 
     gameField->addItem(new StatusBar(
-        sf::Vector2f(fullResolution.x, fullResolution.y / 20), 
+        sf::Vector2f(Resolution::LW, Resolution::LH / 20), 
         gameField->getData()
     ));
 
+    journal.dropDeltas();
     toSave.clear();
     toSave.push_back(settings);
     toSave.push_back(sessionPlayers);
@@ -1643,46 +3843,350 @@ void Game::init() {
 }
 
 void Game::process() {
-    int tick = 16000;
+    int tick = Timing::TICK_USEC;
     while (window->isOpen()) {
         timer.restart();
-        eventHandler({EventType::FRAME, nullptr});
+        {
+            PROFILE_ZONE("frame");
+            eventHandler({EventType::FRAME, nullptr});
+        }
         int slp = tick - timer.getElapsedTime().asMicroseconds();
         usleep(std::max(slp, 0));
     }
 }
 
+MappedFile::MappedFile(const std::string &filename) {
+    data = nullptr;
+    size = 0;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) == 0 && stat_buf.st_size > 0) {
+        void* mapped = mmap(nullptr, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = (const char*)mapped;
+            size = stat_buf.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data) munmap((void*)data, size);
+}
+
+SaveWriter::SaveWriter() {
+    stop = false;
+    worker = std::thread(&SaveWriter::run, this);
+}
+
+SaveWriter::~SaveWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+// Anything but a delta supersedes what is still queued for the same files, deltas are written in order
+void SaveWriter::post(SaveJob job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job.kind != SaveJobKind::SJ_APPEND) {
+            jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&job](SaveJob &queued) { return queued.name == job.name; }), jobs.end());
+        }
+        jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+bool SaveWriter::pending(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (busy == name) return true;
+    return std::any_of(jobs.begin(), jobs.end(), [&name](SaveJob &queued) { return queued.name == name; });
+}
+
+void SaveWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && busy.empty(); });
+}
+
+void SaveWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stop || !jobs.empty(); });
+        if (jobs.empty()) return;
+        SaveJob job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = job.name;
+        lock.unlock();
+        // The slot header goes last, so it never describes a save that did not land
+        bool ok = write(job) && (job.header.empty() || writeFile(job.name + ".head", job.header));
+        EventDispatcher::setEvent({ok ? job.done : job.failed, nullptr});
+        lock.lock();
+        busy.clear();
+        idle.notify_all();
+    }
+}
+
+// For exports the snapshot is decoded into a detached copy of the game state, settings included, so text and json are built
+// from what the main thread captured without touching live objects.
+bool SaveWriter::write(const SaveJob &job) {
+    PROFILE_ZONE("SaveWriter::write");
+    if (job.kind == SaveJobKind::SJ_TRACE) return writeFile(job.name, job.data);
+    if (job.kind == SaveJobKind::SJ_APPEND) return appendFile(job.name + ".delta", job.data);
+    unlink((job.name + ".delta").c_str());
+    if (job.kind == SaveJobKind::SJ_DISCARD) return unlink((job.name + ".bin").c_str()) == 0 || errno == ENOENT;
+    if (!writeFile(job.name + ".bin", job.data)) return false;
+    if (job.kind != SaveJobKind::SJ_EXPORT) return true;
+    Proxy proxy;
+    std::vector <SaveloadObject*> blank = {new Settings(Difficulty::DF_MEDIUM, {Resolution::W0, Resolution::H0}), new Players(), new GameField()};
+    std::vector <SaveloadObject*> detached = blank;
+    bool written = proxy.from_binary(detached, job.data.data(), job.data.size());
+    if (written) {
+        proxy.migrate(detached);
+        written = writeFile(job.name + ".txt", proxy.to_string(detached) + '\n') && writeFile(job.name + ".json", proxy.dump_json(detached) + '\n');
+    }
+    for (int i = 0; i < blank.size(); ++i) {
+        if (detached[i] != blank[i]) delete detached[i];
+        delete blank[i];
+    }
+    return written;
+}
+
+// The index up front gives each section's name, offset and size, so a load can jump straight to the ones it wants
 std::string Proxy::to_string(std::vector <SaveloadObject*> &toSave) {
-    std::stringstream strStream;
+    std::vector <std::string> sections;
     for (int i = 0; i < toSave.size(); ++i) {
+        std::stringstream strStream;
         toSave[i]->to_string(strStream);
+        sections.push_back(strStream.str());
+    }
+    std::stringstream strStream;
+    strStream << "Save\n\tVersion " << SaveFormat::SF_VERSION << "\n\tSections " << sections.size() << '\n';
+    size_t offset = 0;
+    for (int i = 0; i < sections.size(); ++i) {
+        strStream << "\tSection " << sectionNames[i] << "\n\t\tOffset " << offset << "\n\t\tSize " << sections[i].size() << '\n';
+        offset += sections[i].size();
     }
     std::string seri = strStream.str();
+    for (std::string &section : sections) {
+        seri += section;
+    }
     return seri;
 }
 
-json Proxy::to_json(std::vector <SaveloadObject*> &toSave) {
-    json seri;
+// Sections go out in name order, the order saves have always had
+std::string Proxy::dump_json(std::vector <SaveloadObject*> &toSave) {
+    std::vector <int> order;
     for (int i = 0; i < toSave.size(); ++i) {
-        seri[i] = toSave[i]->to_json();
+        order.push_back(i);
     }
+    std::sort(order.begin(), order.end(), [](int a, int b) { return sectionNames[a] < sectionNames[b]; });
+    std::string seri;
+    JsonWriter writer(seri);
+    writer.beginObject();
+    writer.key("sections");
+    writer.beginObject();
+    for (int i : order) {
+        writer.key(sectionNames[i].c_str());
+        toSave[i]->to_json(writer);
+    }
+    writer.endObject();
+    writer.key("version"); writer.value(SaveFormat::SF_VERSION);
+    writer.endObject();
     return seri;
 }
 
-void Proxy::from_string(std::vector <SaveloadObject*> &toLoad, std::stringstream &strStream) {
+bool Proxy::from_string(std::vector <SaveloadObject*> &toLoad, TextReader &reader) {
+    // Unversioned saves hold the sections back to back in a fixed order
+    if (!reader.peek("Save")) {
+        version = 1;
+        int last = -1;
+        for (int i = 0; i < toLoad.size(); ++i) {
+            if (toLoad[i]) last = i;
+        }
+        for (int i = 0; i <= last && reader.ok(); ++i) {
+            if (toLoad[i]) {
+                toLoad[i] = toLoad[i]->from_string(reader);
+            } else {
+                reader.skipTo(sectionNames[i + 1]);
+            }
+        }
+        return reader.ok();
+    }
+    reader.expect("Save");
+    version = reader.number<int>("Version");
+    if (reader.ok() && (version < 1 || version > SaveFormat::SF_VERSION)) {
+        reader.fail("a version up to " + std::to_string(SaveFormat::SF_VERSION), reader.lastToken());
+    }
+    int size = reader.number<int>("Sections");
+    std::vector <std::pair<size_t, size_t>> index(toLoad.size(), {0, 0});
+    std::vector <std::string_view> entries(toLoad.size());
+    for (int i = 0; i < size && reader.ok(); ++i) {
+        int id = sectionId(reader.word("Section"));
+        size_t offset = reader.number<size_t>("Offset");
+        size_t length = reader.number<size_t>("Size");
+        if (id >= 0 && id < toLoad.size()) {
+            index[id] = {offset, length};
+            entries[id] = reader.lastToken();
+        }
+    }
+    reader.mark();
+    for (int i = 0; i < toLoad.size() && reader.ok(); ++i) {
+        if (!toLoad[i]) continue;
+        if (entries[i].empty()) {
+            reader.fail("a section named " + sectionNames[i], reader.lastToken());
+            break;
+        }
+        if (!reader.jump(index[i].first, index[i].second)) {
+            reader.fail("a section inside the file", entries[i]);
+            break;
+        }
+        toLoad[i] = toLoad[i]->from_string(reader);
+    }
+    return reader.ok();
+}
+
+bool Proxy::from_json(std::vector <SaveloadObject*> &toLoad, const char* data, size_t size) {
+    std::vector <bool> wanted;
+    for (SaveloadObject* obj : toLoad) {
+        wanted.push_back(obj != nullptr);
+    }
+    JsonLoader loader(wanted);
+    if (toLoad.size() != SaveSectionId::SS_COUNT || !json::sax_parse(data, data + size, &loader) || !loader.complete()) return false;
+    version = loader.getVersion() ? loader.getVersion() : 1;
+    if (version > SaveFormat::SF_VERSION) return false;
+    std::vector <std::string> sections = loader.sections();
     for (int i = 0; i < toLoad.size(); ++i) {
-        toLoad[i] = toLoad[i]->from_string(strStream);
+        if (!toLoad[i]) continue;
+        const char* cur = sections[i].data();
+        toLoad[i] = toLoad[i]->from_binary(cur);
+    }
+    if (toLoad[SaveSectionId::SS_SETTINGS]) ((Settings*)toLoad[SaveSectionId::SS_SETTINGS])->setSpace(loader.getSpace());
+    if (toLoad[SaveSectionId::SS_FIELD]) ((GameField*)toLoad[SaveSectionId::SS_FIELD])->addLegacyTimers(loader.getLegacyTimers());
+    return true;
+}
+
+// Brings sections read from an older schema up to SF_VERSION in one pass over the loaded objects.
+// 1 -> 2: coordinates were pixels of the recorded resolution and move into the logical space, and bonus timers
+// counted seconds rather than ticks.
+// 2 -> 3: text and JSON gained the version and section index; section contents are unchanged
+void Proxy::migrate(std::vector <SaveloadObject*> &toLoad) {
+    if (version < 2 && toLoad[SaveSectionId::SS_FIELD]) ((GameField*)toLoad[SaveSectionId::SS_FIELD])->migrateTimers();
+    Settings* settings = (Settings*)toLoad[SaveSectionId::SS_SETTINGS];
+    if (settings) {
+        std::pair<int, int> space = settings->getSpace();
+        if (version < 2 && !space.first) space = {settings->getSavedResolution().first, settings->getSavedResolution().second};
+        if (!space.first) space = {Resolution::LW, Resolution::LH};
+        if (space != std::pair<int, int>(Resolution::LW, Resolution::LH)) {
+            sf::Vector2f koef((float)Resolution::LW / space.first, (float)Resolution::LH / space.second);
+            if (toLoad[SaveSectionId::SS_FIELD]) ((GameField*)toLoad[SaveSectionId::SS_FIELD])->scaleBound(koef);
+            if (toLoad[SaveSectionId::SS_PLAYERS]) {
+                for (Player* player : ((Players*)toLoad[SaveSectionId::SS_PLAYERS])->getPlayers()) {
+                    player->getPlatform()->scaleBound(koef);
+                    for (Ball* ball : player->getBalls()) {
+                        ball->scaleBound(koef);
+                    }
+                }
+            }
+        }
+        settings->setSpace({Resolution::LW, Resolution::LH});
+    }
+    version = SaveFormat::SF_VERSION;
+}
+
+std::string Proxy::to_binary(std::vector <SaveloadObject*> &toSave) {
+    std::string seri(sizeof(SaveHeader) + toSave.size() * sizeof(SaveSection), '\0');
+    std::vector <SaveSection> sections;
+    for (int i = 0; i < toSave.size(); ++i) {
+        uint32_t offset = seri.size();
+        toSave[i]->to_binary(seri);
+        sections.push_back({(uint32_t)i, offset, (uint32_t)(seri.size() - offset)});
+    }
+    memcpy(&seri[sizeof(SaveHeader)], sections.data(), sections.size() * sizeof(SaveSection));
+    SaveHeader header{SaveFormat::SF_MAGIC, SaveFormat::SF_VERSION, (uint16_t)sections.size(), (uint32_t)seri.size(), 0};
+    header.crc = crc32(seri.data() + sizeof(SaveHeader), seri.size() - sizeof(SaveHeader));
+    memcpy(&seri[0], &header, sizeof(SaveHeader));
+    base = header.crc;
+    baseBytes = seri.size();
+    deltas = 0;
+    deltaBytes = 0;
+    for (SaveloadObject* obj : toSave) {
+        if (dynamic_cast<GameField*>(obj)) visible = ((GameField*)obj)->getVisibility();
+    }
+    return seri;
+}
+
+// Deltas chain onto the last full image this proxy wrote; an empty result means a new full image is due
+std::string Proxy::to_delta(std::vector <SaveloadObject*> &toSave) {
+    if (!base || deltas >= SaveFormat::SF_DELTA_RECORDS || deltaBytes > baseBytes) return "";
+    if (limit && baseBytes + deltaBytes > limit) return "";
+    std::string seri(sizeof(DeltaHeader), '\0');
+    for (SaveloadObject* obj : toSave) {
+        if (dynamic_cast<Players*>(obj)) obj->to_binary(seri);
+        if (dynamic_cast<GameField*>(obj)) ((GameField*)obj)->to_delta(seri, visible);
+    }
+    DeltaHeader header{SaveFormat::SF_DELTA, base, (uint32_t)(seri.size() - sizeof(DeltaHeader)), 0};
+    header.crc = crc32(seri.data() + sizeof(DeltaHeader), header.size);
+    memcpy(&seri[0], &header, sizeof(DeltaHeader));
+    deltas++;
+    deltaBytes += seri.size();
+    return seri;
+}
+
+// Replays records made against the image last read by from_binary, stopping at the first torn or foreign one.
+// The players that image read are no one else's yet, so each record frees the ones it replaces
+void Proxy::from_delta(std::vector <SaveloadObject*> &toLoad, const char* data, size_t size) {
+    const char* end = data + size;
+    while (end - data >= sizeof(DeltaHeader)) {
+        DeltaHeader header;
+        memcpy(&header, data, sizeof(DeltaHeader));
+        const char* cur = data + sizeof(DeltaHeader);
+        if (header.magic != SaveFormat::SF_DELTA || header.base != base || header.size > end - cur) return;
+        if (header.crc != crc32(cur, header.size)) return;
+        for (int i = 0; i < toLoad.size(); ++i) {
+            if (dynamic_cast<Players*>(toLoad[i])) {
+                SaveloadObject* loaded = toLoad[i]->from_binary(cur);
+                delete toLoad[i];
+                toLoad[i] = loaded;
+            }
+            if (dynamic_cast<GameField*>(toLoad[i]) && !((GameField*)toLoad[i])->apply_delta(cur)) return;
+        }
+        data += sizeof(DeltaHeader) + header.size;
     }
 }
 
-void Proxy::from_json(std::vector <SaveloadObject*> &toLoad, json &deri) {
+bool Proxy::from_binary(std::vector <SaveloadObject*> &toLoad, const char* data, size_t size, bool verify) {
+    if (size < sizeof(SaveHeader)) return false;
+    SaveHeader header;
+    memcpy(&header, data, sizeof(SaveHeader));
+    if (header.magic != SaveFormat::SF_MAGIC || header.version > SaveFormat::SF_VERSION || header.size != size) return false;
+    if (sizeof(SaveHeader) + header.sections * sizeof(SaveSection) > size) return false;
+    if (verify && header.crc != crc32(data + sizeof(SaveHeader), size - sizeof(SaveHeader))) return false;
+    std::vector <SaveSection> sections(header.sections);
+    memcpy(sections.data(), data + sizeof(SaveHeader), sections.size() * sizeof(SaveSection));
+    std::vector <bool> found(toLoad.size());
+    for (SaveSection &section : sections) {
+        if (section.offset > size || section.size > size - section.offset) return false;
+        if (section.id >= toLoad.size()) continue;
+        found[section.id] = true;
+    }
     for (int i = 0; i < toLoad.size(); ++i) {
-        toLoad[i] = toLoad[i]->from_json(deri[i]);
+        if (toLoad[i] && !found[i]) return false;
+    }
+    for (SaveSection &section : sections) {
+        const char* cur = data + section.offset;
+        if (section.id < toLoad.size() && toLoad[section.id]) toLoad[section.id] = toLoad[section.id]->from_binary(cur);
     }
+    version = header.version;
+    base = header.crc;
+    return true;
 }
 
-MessageBox::MessageBox(EventType event, std::string str, sf::Vector2f size) : DisplayObject(size, sf::Vector2f((Settings::getResolution().first - size.x) / 2, (Settings::getResolution().second - size.y) / 2), sf::Color(0, 0, 0, 0)) {
-    sf::Vector2f nullPoint = sf::Vector2f((Settings::getResolution().first - size.x) / 2, (Settings::getResolution().second - size.y) / 2);
+MessageBox::MessageBox(EventType event, std::string str, sf::Vector2f size) : DisplayObject(size, sf::Vector2f((Resolution::LW - size.x) / 2, (Resolution::LH - size.y) / 2), sf::Color(0, 0, 0, 0)) {
+    sf::Vector2f nullPoint = sf::Vector2f((Resolution::LW - size.x) / 2, (Resolution::LH - size.y) / 2);
     text = new TextBlock(sf::Vector2f(size.x, size.y * 5 / 6), nullPoint, sf::Color::Red, str);
     button = new Button(sf::Vector2f(size.x / 2, size.y / 3), sf::Vector2f(nullPoint.x + size.x / 4, nullPoint.y + size.y * 5 / 6), sf::Color::Blue, "OK", event);
 }
@@ -1708,79 +4212,79 @@ void MessageBox::update(sf::Vector2i mousePos, bool pressed) {
     }
 }
 
-Bonus::Bonus(sf::Vector2f size, sf::Vector2f pos, float vel) : MovableObject(size, pos, sf::Color::White, sf::Vector2f(0, vel)) {
-    bonus = (EventType)(ceil((float)unif(rng) * 6) + 100);
-    std::string filepath = "";
+Bonus::Bonus(sf::Vector2f size, sf::Vector2f pos, float vel, EventType e) : MovableObject(size, pos, sf::Color::White, sf::Vector2f(0, vel)) {
+    setBonus(e);
+}
+
+static std::string bonusSprite(EventType bonus) {
     switch (bonus) {
     case EventType::BALL_FASTEN:
-        filepath = "BSPU.png";
-        break;
+        return "BSPU.png";
     case EventType::BALL_SLOWEN:
-        filepath = "BSPD.png";
-        break;
+        return "BSPD.png";
     case EventType::PLATFORM_FASTEN:
-        filepath = "PSPU.png";
-        break;
+        return "PSPU.png";
     case EventType::PLATFORM_SLOWEN:
-        filepath = "PSPD.png";
-        break;
+        return "PSPD.png";
     case EventType::PLATFORM_LONGEN:
-        filepath = "PSZU.png";
-        break;
+        return "PSZU.png";
     case EventType::PLATFORM_SHORTEN:
-        filepath = "PSZD.png";
-        break;
+        return "PSZD.png";
     }
-    sf::Texture* texture = new sf::Texture();
-    texture->loadFromFile(filepath);
-    shape->setTexture(texture, true);
+    return "";
 }
 
 void Bonus::setBonus(EventType e) { 
+    static std::map<EventType, sf::Texture*> textures;
+    static std::mutex texturesMutex;
+    std::lock_guard<std::mutex> lock(texturesMutex);
     bonus = e; 
-    std::string filepath = "";
-    switch (bonus) {
-    case EventType::BALL_FASTEN:
-        filepath = "BSPU.png";
-        break;
-    case EventType::BALL_SLOWEN:
-        filepath = "BSPD.png";
-        break;
-    case EventType::PLATFORM_FASTEN:
-        filepath = "PSPU.png";
-        break;
-    case EventType::PLATFORM_SLOWEN:
-        filepath = "PSPD.png";
-        break;
-    case EventType::PLATFORM_LONGEN:
-        filepath = "PSZU.png";
-        break;
-    case EventType::PLATFORM_SHORTEN:
-        filepath = "PSZD.png";
-        break;
+    if (textures.count(bonus)) {
+        shape->setTexture(textures[bonus], true);
+        return;
     }
     sf::Texture* texture = new sf::Texture();
-    texture->loadFromFile(filepath);
+    texture->loadFromFile(bonusSprite(bonus));
+    textures[bonus] = texture;
     shape->setTexture(texture, true);
 }
 
+// Sprites are read into memory once per bonus; one that fails to load shows white, as the texture would
+void Bonus::rasterize(Canvas &canvas) {
+    static std::map<EventType, sf::Image*> images;
+    static std::mutex imagesMutex;
+    if (!isVisible()) return;
+    sf::Image* image;
+    {
+        std::lock_guard<std::mutex> lock(imagesMutex);
+        if (!images.count(bonus)) {
+            images[bonus] = new sf::Image();
+            images[bonus]->loadFromFile(bonusSprite(bonus));
+        }
+        image = images[bonus];
+    }
+    canvas.blit(getBound(), *image);
+}
+
 void Bonus::checkCollision(DisplayObject *obj)
 {
     if (!dynamic_cast<Platform*>(obj)) return;
     sf::FloatRect objBounds = obj->getBound();
     float horizontalIntersect = -1, verticalIntersect = -1;
-    std::vector <std::pair<float, bool> > horI;
-    horI.push_back({bounds.left, 1});
-    horI.push_back({bounds.left + bounds.width, 1});
-    horI.push_back({objBounds.left, 0});
-    horI.push_back({objBounds.left + objBounds.width, 0});
+    std::array <std::pair<float, bool>, 4> horI = {{
+        {box().left, 1},
+        {box().left + box().width, 1},
+        {objBounds.left, 0},
+        {objBounds.left + objBounds.width, 0}
+    }};
     sort(horI.begin(), horI.end());
     if (horI[0].second != horI[1].second) horizontalIntersect = horI[2].first - horI[1].first;
-    std::vector <std::pair<float, bool> > verI;
-    verI.push_back({bounds.top, 1});
-    verI.push_back({bounds.top + bounds.height, 1});
-    verI.push_back({objBounds.top, 0});
-    verI.push_back({objBounds.top + objBounds.height, 0});
+    std::array <std::pair<float, bool>, 4> verI = {{
+        {box().top, 1},
+        {box().top + box().height, 1},
+        {objBounds.top, 0},
+        {objBounds.top + objBounds.height, 0}
+    }};
     sort(verI.begin(), verI.end());
     if (verI[0].second != verI[1].second) verticalIntersect = verI[2].first - verI[1].first;
     if (horizontalIntersect != -1 && verticalIntersect != -1) {
@@ -1794,9 +4298,9 @@ void Bonus::checkCollision(DisplayObject *obj)
 }
 
 void Bonus::checkBounds() {
-    int w = Settings::getResolution().first, h = Settings::getResolution().second;
-    if (bounds.left < 0 || bounds.left + bounds.width > w) EventDispatcher::setGameEvent({EventType::VERTICAL_COLLISION, this});
-    if (bounds.top + bounds.height > h) EventDispatcher::setGameEvent({EventType::BONUS_FALL, this});
+    int w = Resolution::LW, h = Resolution::LH;
+    if (box().left < 0 || box().left + box().width > w) EventDispatcher::setGameEvent({EventType::VERTICAL_COLLISION, this});
+    if (box().top + box().height > h) EventDispatcher::setGameEvent({EventType::BONUS_FALL, this});
 }
 
 void Bonus::eventHandler(Event e) {
@@ -1813,44 +4317,45 @@ void Bonus::eventHandler(Event e) {
 }
 
 void Bonus::to_string(std::stringstream &strStream) {
-    strStream << "\t\tBonus\n\t\t\tType " << bonus << "\n\t\t\tX " << bounds.left << "\n\t\t\tY " << bounds.top << "\n\t\t\tWidth " << bounds.width << "\n\t\t\tHeight " << bounds.height << "\n\t\t\tYVelocity " << velocity.y << "\n\t\t\tVisible " << visible << '\n';
-}
-
-SaveloadObject *Bonus::from_string(std::stringstream &strStream) {
-    float x, y, w, h, vis, vel;
-    int event;
-    std::string temp;
-    strStream >> temp >> temp >> event >> temp >> x >> temp >> y >> temp >> w >> temp >> h >> temp >> vel >> temp >> vis;
-    Bonus* bon = new Bonus(sf::Vector2f(w, h), sf::Vector2f(x, y), vel);
-    bon->setBonus((EventType)event);
+    strStream << "\t\tBonus\n\t\t\tType " << bonus << "\n\t\t\tX " << box().left << "\n\t\t\tY " << box().top << "\n\t\t\tWidth " << box().width << "\n\t\t\tHeight " << box().height << "\n\t\t\tYVelocity " << vel().y << "\n\t\t\tVisible " << isVisible() << '\n';
+}
+
+SaveloadObject *Bonus::from_string(TextReader &reader) {
+    reader.expect("Bonus");
+    int event = reader.number<int>("Type");
+    float x = reader.number<float>("X");
+    float y = reader.number<float>("Y");
+    float w = reader.number<float>("Width");
+    float h = reader.number<float>("Height");
+    float vel = reader.number<float>("YVelocity");
+    bool vis = reader.number<int>("Visible");
+    Bonus* bon = new Bonus(sf::Vector2f(w, h), sf::Vector2f(x, y), vel, (EventType)event);
     bon->setVisible(vis);
     return bon;
 }
 
-json Bonus::to_json() {
-    json seri{};
-    seri["bonus"]["type"] = bonus;
-    seri["bonus"]["x"] = bounds.left;
-    seri["bonus"]["y"] = bounds.top;
-    seri["bonus"]["width"] = bounds.width;
-    seri["bonus"]["height"] = bounds.height;
-    seri["bonus"]["y_velocity"] = velocity.y;
-    seri["bonus"]["visible"] = visible;
-    return seri;
+void Bonus::to_json(JsonWriter &writer) {
+    writer.beginObject();
+    writer.key("bonus");
+    writer.beginObject();
+    writer.key("height"); writer.value(box().height);
+    writer.key("type"); writer.value(bonus);
+    writer.key("visible"); writer.value(isVisible());
+    writer.key("width"); writer.value(box().width);
+    writer.key("x"); writer.value(box().left);
+    writer.key("y"); writer.value(box().top);
+    writer.key("y_velocity"); writer.value(vel().y);
+    writer.endObject();
+    writer.endObject();
 }
 
-SaveloadObject* Bonus::from_json(json &deri) {
-    float x, y, w, h, vis, vel;
-    int event;
-    event = deri["bonus"]["type"].get<int>();
-    x = deri["bonus"]["x"].get<float>();
-    y = deri["bonus"]["y"].get<float>();
-    w = deri["bonus"]["width"].get<float>();
-    h = deri["bonus"]["height"].get<float>();
-    vel = deri["bonus"]["y_velocity"].get<float>();
-    vis = deri["bonus"]["visible"].get<bool>();
-    Bonus* bon = new Bonus(sf::Vector2f(w, h), sf::Vector2f(x, y), vel);
-    bon->setBonus((EventType)event);
-    bon->setVisible(vis);
+void Bonus::to_binary(std::string &buf) {
+    putRecord(buf, BonusRecord{box().left, box().top, box().width, box().height, vel().y, bonus, isVisible()});
+}
+
+SaveloadObject* Bonus::from_binary(const char* &cur) {
+    BonusRecord record = getRecord<BonusRecord>(cur);
+    Bonus* bon = new Bonus(sf::Vector2f(record.width, record.height), sf::Vector2f(record.x, record.y), record.yVelocity, (EventType)record.type);
+    bon->setVisible(record.visible);
     return bon;
 }
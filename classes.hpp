@@ -34,6 +34,10 @@ enum Resolution {
 
     FW = 1921,
     FH = 1080,
+
+    // Logical extent the simulation runs in, the window view maps it onto whatever resolution is picked
+    LW = 1920,
+    LH = 1000,
 };
 
 enum Active {
@@ -43,7 +47,52 @@ enum Active {
     PAUSE,
     MESSAGE_START,
     MESSAGE_WIN,
-    MESSAGE_LOSE
+    MESSAGE_LOSE,
+    SLOTS
+};
+
+enum Timing {
+    TICK_USEC = 16000,
+    BONUS_TICKS = 625,
+    AUTOSAVE_TICKS = 625,
+    REWIND_TICKS = 31,
+    REWIND_SNAPSHOTS = 16,
+    LOOKAHEAD_TICKS = 600,
+};
+
+enum Profiling {
+    PF_RING = 16384,
+};
+
+enum MotionFlags {
+    MF_VISIBLE = 1,
+    MF_STEERED = 2,
+};
+
+enum SaveFormat {
+    SF_VERSION = 3,
+    SF_MAGIC = 0x534b5241,
+    SF_DELTA = 0x534b5244,
+    SF_DELTA_RECORDS = 32,
+    SF_JOURNAL_CAP = 65536,
+    SF_SLOT = 0x534b5248,
+    SF_SLOTS = 4,
+};
+
+// Sections of a save; toSave and toLoad are indexed by these and a null entry is left unloaded
+enum SaveSectionId {
+    SS_SETTINGS,
+    SS_PLAYERS,
+    SS_FIELD,
+    SS_COUNT,
+};
+
+enum SaveJobKind {
+    SJ_FULL,
+    SJ_EXPORT,
+    SJ_APPEND,
+    SJ_DISCARD,
+    SJ_TRACE,
 };
 
 enum Coefficients {
@@ -65,6 +114,12 @@ enum BallSize {
 enum ObstacleNum {
     OB_ROW = 12,
     OB_COLUMN = 28,
+    OB_COMPACT = 4096,
+};
+
+enum BrickCell {
+    BC_BONUS = 0x0F,
+    BC_ALIVE = 0x80,
 };
 
 enum Difficulty {
@@ -129,6 +184,17 @@ enum EventType {
     PLATFORM_LONGEN_DECLINE,
     BALL_FASTEN_DECLINE,
     BALL_SLOWEN_DECLINE,
+    SAVE_DONE,
+    SAVE_FAILED,
+    AUTOSAVE_DONE,
+    AUTOSAVE_FAILED,
+    TO_SAVE_SLOTS,
+    TO_LOAD_SLOTS,
+    SLOT,
+    REWIND,
+    TRACE_DONE,
+    TRACE_FAILED,
+    NO_BONUS = 100,
     PLATFORM_FASTEN = 101,
     PLATFORM_SLOWEN = 102,
     PLATFORM_SHORTEN = 103,
@@ -139,17 +205,143 @@ enum EventType {
 
 class DisplayObject;
 
+// Frame drawn on the CPU for headless runs, into a caller's buffer of width x height pixels, 4 bytes RGBA or
+// 1 byte gray each. The logical extent is mapped onto the whole frame; a shape covers the pixels whose
+// centres it holds, and one narrower than a pixel still takes the pixel under its middle
+class Canvas {
+private:
+    uint8_t* pixels;
+    int width, height, channels;
+    float scaleX, scaleY;
+    std::pair<int, int> span(float from, float to, float scale, int limit);
+    void fillRow(int y, int x0, int x1, sf::Color col);
+public:
+    Canvas(uint8_t* buffer, int w, int h, int c, sf::Vector2f extent = sf::Vector2f(Resolution::LW, Resolution::LH));
+    // Pixels are 1 (gray) or 4 (RGBA) bytes; callers with outside sizes check them here first
+    static bool fits(int w, int h, int c) { return w > 0 && h > 0 && (c == 1 || c == 4); }
+    static void benchmark(int size);
+    int getWidth() { return width; }
+    int getHeight() { return height; }
+    int getChannels() { return channels; }
+    void clear(sf::Color col);
+    void fillRect(sf::FloatRect rect, sf::Color col);
+    void fillCircle(sf::FloatRect rect, sf::Color col);
+    void blit(sf::FloatRect rect, const sf::Image &image);
+    // .ppm and .pgm are written here, other extensions go through sf::Image
+    bool save(const std::string &filename);
+};
+
+class JsonWriter {
+private:
+    std::string &out;
+    std::vector<std::pair<bool, bool>> scopes;
+    void prefix();
+    void separate();
+    void close(char bracket);
+public:
+    JsonWriter(std::string &buf) : out(buf) {}
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(const char* name);
+    void value(double num);
+    void value(long long num);
+    void value(bool flag);
+    void value(const std::string &str);
+    void value(int num) { value((long long)num); }
+    void value(size_t num) { value((long long)num); }
+    void value(float num) { value((double)num); }
+};
+
+// Timing zones for frame profiling, compiled in only with -DARCANOID_PROFILE. Each thread records finished
+// zones into its own ring, which only it writes; an export reads every ring without stopping the writers and
+// drops the records overwritten while it read
+struct ProfileRecord {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start, end;
+};
+
+struct ProfileRing {
+    std::array<ProfileRecord, Profiling::PF_RING> records;
+    std::atomic<uint64_t> head{0};
+    int thread;
+};
+
+class Profiler {
+private:
+    static std::mutex mutex;
+    static std::vector<ProfileRing*> rings;
+    static std::atomic<bool> requested;
+public:
+    static ProfileRing* ring();
+    static uint64_t now();
+    static void record(const char* name, uint64_t start);
+    // Safe to call from a signal handler; the game exports on its next frame
+    static void request() { requested = true; }
+    static bool takeRequest() { return requested.exchange(false); }
+#ifdef ARCANOID_PROFILE
+    static std::string exportTrace();
+#endif
+};
+
+class ProfileZone {
+private:
+    const char* name;
+    uint64_t start;
+public:
+    ProfileZone(const char* n) : name(n), start(Profiler::now()) {}
+    ~ProfileZone() { Profiler::record(name, start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifdef ARCANOID_PROFILE
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
 struct Event {
     EventType type;
     DisplayObject* obj;
 };
 
+// Tokenizer for save.txt: labels and values are views into the mapped file, the first mismatch
+// sticks with its line and column and every later read yields nothing
+class TextReader {
+private:
+    const char* start;
+    const char* cur;
+    const char* end;
+    const char* fileEnd;
+    const char* body = nullptr;
+    std::string_view last;
+    std::string failure;
+    std::string_view token();
+public:
+    TextReader(const char* data, size_t size);
+    void fail(const std::string &wanted, std::string_view got);
+    std::string_view lastToken() { return last; }
+    void expect(std::string_view label);
+    bool peek(std::string_view label);
+    void skipTo(std::string_view label);
+    void mark();
+    bool jump(size_t offset, size_t size);
+    std::string_view word(std::string_view label);
+    template<class T> T number(std::string_view label);
+    bool ok() { return failure.empty(); }
+    const std::string& error() { return failure; }
+};
+
 class SaveloadObject {
 public:
+    virtual ~SaveloadObject() {}
     virtual void to_string(std::stringstream &strStream)=0;
-    virtual SaveloadObject* from_string(std::stringstream &strStream)=0;
-    virtual json to_json()=0;
-    virtual SaveloadObject* from_json(json &deri)=0;
+    virtual SaveloadObject* from_string(TextReader &reader)=0;
+    virtual void to_json(JsonWriter &writer)=0;
+    virtual void to_binary(std::string &buf)=0;
+    virtual SaveloadObject* from_binary(const char* &cur)=0;
 };
 
 class DisplayObject : public SaveloadObject {
@@ -159,6 +351,7 @@ protected:
     sf::FloatRect bounds;
     bool visible;
     sf::Vector2f position;
+    bool ownsShape = true;
     DisplayObject(sf::Vector2f size, sf::Vector2f pos = sf::Vector2f(0, 0), sf::Color col = sf::Color(255, 255, 255)) {
         shape = new sf::RectangleShape(size);
         shape->setFillColor(col);
@@ -185,9 +378,14 @@ protected:
         bounds = shape->getGlobalBounds();
         visible = true;
     };
+    // A copy draws with the original's shape and leaves deleting it to the original
+    DisplayObject(const DisplayObject &other) : shape(other.shape), color(other.color), bounds(other.bounds), visible(other.visible), position(other.position), ownsShape(false) {}
 public:
+    ~DisplayObject() override { if (ownsShape) delete shape; }
     virtual void draw(sf::RenderWindow &target);
+    virtual void rasterize(Canvas &canvas);
     virtual void setColor(sf::Color col);
+    sf::Color getColor() { return color; }
     virtual void setVisible(bool state);
     virtual bool isVisible();
     virtual void checkCollision(DisplayObject* obj);
@@ -196,36 +394,80 @@ public:
     virtual sf::FloatRect getBound();
     virtual void scaleBound(sf::Vector2f koef) { 
         shape->setPosition(sf::Vector2f(bounds.left * koef.x, bounds.top * koef.y));
-        shape->setScale(koef);
+        shape->scale(koef);
         bounds = shape->getGlobalBounds();
         position = shape->getPosition(); 
     }
     virtual void to_string(std::stringstream &strStream) override {}
-    virtual SaveloadObject* from_string(std::stringstream &strStream) override { return nullptr; }
-    virtual json to_json() override { return json{}; }
-    virtual SaveloadObject* from_json(json &deri) override { return nullptr; }
+    virtual SaveloadObject* from_string(TextReader &reader) override { return nullptr; }
+    virtual void to_json(JsonWriter &writer) override {}
+    virtual void to_binary(std::string &buf) override {}
+    virtual SaveloadObject* from_binary(const char* &cur) override { return nullptr; }
     virtual void scale(float k) { shape->scale(sf::Vector2f(k, 1)); bounds = shape->getGlobalBounds(); position = shape->getPosition(); }
 };
 
+class MovableObject;
+
+// Slots are packed: removing one moves the last slot into its place, and owners says whose each slot is
+class MotionComponents {
+public:
+    std::vector<sf::FloatRect> bounds;
+    std::vector<sf::Vector2f> velocity, base_vel;
+    std::vector<float> scale_coef;
+    std::vector<uint8_t> flags;
+    std::vector<MovableObject*> owners;
+    int add(sf::FloatRect b, sf::Vector2f vel, sf::Vector2f base, float scale, uint8_t f, MovableObject* owner);
+    void remove(int slot);
+    void claim();
+    void clear();
+    void move();
+};
+
 class MovableObject : public DisplayObject {
+    friend class MotionComponents;
 protected:
-    sf::Vector2f velocity, base_vel;
-    float scale_coef = 1;
+    MotionComponents* motion;
+    int id;
+    bool ownsMotion;
+    sf::FloatRect& box() { return motion->bounds[id]; }
+    sf::Vector2f& vel() { return motion->velocity[id]; }
+    sf::Vector2f& baseVel() { return motion->base_vel[id]; }
+    float& scaleCoef() { return motion->scale_coef[id]; }
     MovableObject(sf::Vector2f size, sf::Vector2f pos = sf::Vector2f(0, 0), sf::Color col = sf::Color(255,255,255), sf::Vector2f vel = sf::Vector2f(0, 0)) : DisplayObject(size, pos, col) {
-        velocity = vel;
-        base_vel = sf::Vector2f(abs(vel.x), abs(vel.y));
+        motion = new MotionComponents();
+        id = motion->add(bounds, vel, sf::Vector2f(abs(vel.x), abs(vel.y)), 1, MotionFlags::MF_VISIBLE, this);
+        ownsMotion = true;
     }
     MovableObject(float size, sf::Vector2f pos = sf::Vector2f(0, 0), sf::Color col = sf::Color(255,255,255), sf::Vector2f vel = sf::Vector2f(0, 0)) : DisplayObject(size, pos, col) {
-        velocity = vel;
-        base_vel = sf::Vector2f(abs(vel.x), abs(vel.y));
+        motion = new MotionComponents();
+        id = motion->add(bounds, vel, sf::Vector2f(abs(vel.x), abs(vel.y)), 1, MotionFlags::MF_VISIBLE, this);
+        ownsMotion = true;
+    }
+    // A copy of a detached object gets its own slot, a copy of an attached one shares the store until rebound
+    MovableObject(const MovableObject &other) : DisplayObject(other), motion(other.motion), id(other.id), ownsMotion(other.ownsMotion) {
+        if (!ownsMotion) return;
+        motion = new MotionComponents(*other.motion);
+        motion->owners[id] = this;
     }
 public:
+    ~MovableObject() override { if (ownsMotion) delete motion; }
+    void attach(MotionComponents* store);
+    void detach();
+    bool attachedTo(MotionComponents* store) { return motion == store; }
+    void rebind(MotionComponents* store) { motion = store; ownsMotion = false; store->owners[id] = this; }
+    void draw(sf::RenderWindow &target) override;
+    void setVisible(bool state) override;
+    bool isVisible() override;
+    sf::FloatRect getBound() override;
+    void setPosition(sf::Vector2f pos);
+    void scale(float k) override;
+    void scaleBound(sf::Vector2f koef) override;
     virtual void move();
-    virtual void move(sf::Vector2f vel);
-    virtual void setVelocity(sf::Vector2f vel);
+    virtual void move(sf::Vector2f v);
+    virtual void setVelocity(sf::Vector2f v);
     virtual sf::Vector2f getVelocity();
-    virtual void setScale() { velocity *= scale_coef; }
-    virtual void scaleSpeed(float k) { scale_coef *= k; velocity = sf::Vector2f(velocity.x / abs(velocity.x) * base_vel.x, velocity.y / abs(velocity.y) * base_vel.y); }
+    virtual void setScale() { vel() *= scaleCoef(); }
+    virtual void scaleSpeed(float k) { scaleCoef() *= k; vel() = sf::Vector2f(vel().x / abs(vel().x) * baseVel().x, vel().y / abs(vel().y) * baseVel().y); }
 };
 
 class Statistics : public SaveloadObject {
@@ -236,6 +478,7 @@ private:
     sf::Clock* clock;
 public:
     Statistics(int l, int s, int c, std::string n, float delay);
+    ~Statistics() override { delete clock; }
     int getCatched() { return catched; }
     int getLives();
     int getScore();
@@ -246,10 +489,12 @@ public:
     void setLives(int num);
     void setScore(int score);
     void setDelay(float d) { delay += d; }
+    void setTime(float t) { delay = t; clock->restart(); }
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class TextBlock : public DisplayObject {
@@ -257,6 +502,7 @@ private:
     sf::Text *text;
 public:
     TextBlock(sf::Vector2f size, sf::Vector2f pos, sf::Color col, std::string title);
+    ~TextBlock() override { delete text; }
     void draw(sf::RenderWindow &target) override;
     void setText(std::string str);
 };
@@ -265,54 +511,90 @@ class Ball : public MovableObject {
 public:
     Ball(float size, sf::Vector2f pos = sf::Vector2f(0, 0), sf::Color col = sf::Color(255,255,255), sf::Vector2f vel = sf::Vector2f(0, 0)) : MovableObject(size, pos, col, vel) {};
     std::pair <Ball*, Ball*> mitosis();
+    void rasterize(Canvas &canvas) override;
     void eventHandler(Event e) override;
+    void scaleBound(sf::Vector2f koef) override;
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
-    int getBaseSpeedAbs(Difficulty diff);
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Platform : public MovableObject {
 public:
-    Platform(sf::Vector2f size, sf::Vector2f pos = sf::Vector2f(0, 0), sf::Color col = sf::Color(255,255,255), float vel = 0) : MovableObject(size, pos, col, sf::Vector2f (vel, 0)) {};
+    Platform(sf::Vector2f size, sf::Vector2f pos = sf::Vector2f(0, 0), sf::Color col = sf::Color(255,255,255), float vel = 0) : MovableObject(size, pos, col, sf::Vector2f (vel, 0)) { motion->flags[id] |= MotionFlags::MF_STEERED; };
+    // Platforms resize their shape as bonuses land, so copies get their own
+    Platform(const Platform &other) : MovableObject(other) { shape = new sf::RectangleShape(*(sf::RectangleShape*)other.shape); ownsShape = true; }
     void eventHandler(Event e) override;
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
-    float getBaseSpeedAbs();
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Bonus : public MovableObject {
 private:
     EventType bonus;
 public:
-    Bonus(sf::Vector2f size, sf::Vector2f pos, float vel);
+    Bonus(sf::Vector2f size, sf::Vector2f pos, float vel, EventType e);
     void setBonus(EventType e);
     EventType getBonus() { return bonus; }
+    void rasterize(Canvas &canvas) override;
     void checkCollision(DisplayObject* obj) override;
     void checkBounds() override;
     void eventHandler(Event e) override;
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Obstacle : public DisplayObject {
 private:
-    std::vector<Bonus*> bonuses;
+    EventType bonus;
+    Bonus* released;
 public:
     Obstacle(sf::Vector2f size, sf::Vector2f pos, sf::Color col);
     void eventHandler(Event e) override;
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
-    std::vector<Bonus*> getBonuses() { return bonuses; }
-    void addBonus(Bonus* bonus) { bonuses.push_back(bonus); }
-    void clearBonuses() { bonuses.clear(); }
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
+    EventType getBonus() { return bonus; }
+    void setBonus(EventType e) { bonus = e; }
+    Bonus* getReleased() { return released; }
+    void setReleased(Bonus* b) { released = b; }
+};
+
+class BrickGrid : public DisplayObject {
+private:
+    int rows, columns, alive;
+    sf::Vector2f origin, pitch;
+    std::vector<uint8_t> cells;
+    std::vector<int> hits;
+    std::string packCells();
+    bool unpackCells(std::string_view packed);
+public:
+    BrickGrid(int r, int c, sf::Vector2f org, sf::Vector2f step, sf::Vector2f brick);
+    sf::FloatRect getCellBound(int cell);
+    std::vector<uint8_t>& getCells() { return cells; }
+    int getAlive() { return alive; }
+    void toggleCell(int cell);
+    void refill();
+    void draw(sf::RenderWindow &target) override;
+    void rasterize(Canvas &canvas) override;
+    void scaleBound(sf::Vector2f koef) override;
+    void checkCollision(DisplayObject* obj) override;
+    void eventHandler(Event e) override;
+    void to_string(std::stringstream &strStream) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Button : public DisplayObject {
@@ -321,6 +603,7 @@ private:
     TextBlock* text;
 public:
     Button(sf::Vector2f size, sf::Vector2f pos, sf::Color col, std::string title, EventType e);
+    ~Button() override { delete text; }
     void draw(sf::RenderWindow &target) override;
     void sendEvent();
     void setColor(sf::Color col);
@@ -334,7 +617,9 @@ private:
     Button* menu;
 public:
     StatusBar(sf::Vector2f size, Statistics* stats);
+    ~StatusBar() override;
     void draw(sf::RenderWindow &target) override;
+    void rasterize(Canvas &canvas) override;
     void update(Statistics* stats, sf::Vector2i mousePos, bool pressed);
 };
 
@@ -344,28 +629,63 @@ private:
     TextBlock* text;
 public:
     MessageBox(EventType event, std::string str, sf::Vector2f size);
+    ~MessageBox() override { delete button; delete text; }
     void draw(sf::RenderWindow &target) override;
     void setText(std::string str);
     void update(sf::Vector2i mousePos, bool pressed);
 };
 
+// Everything the simulation derives from the settings, in logical units
+struct PhysicsConstants {
+    float ballSpeed, ballLaunch, ballSize;
+    double ballSpeedRoot;
+    float platformSpeed, platformWidth, platformHeight;
+    float bonusSpeed;
+    float ballFasten, ballFastenInverse, ballSlowen, ballSlowenInverse;
+    float platformFasten, platformFastenInverse, platformSlowen, platformSlowenInverse;
+    float platformLongen, platformLongenInverse;
+};
+
+class Physics {
+private:
+    static PhysicsConstants constants;
+    static PhysicsConstants compute(Difficulty diff);
+public:
+    static const PhysicsConstants& get() { return constants; }
+    static void update(Difficulty diff) { constants = compute(diff); }
+};
+
 class Settings : public SaveloadObject {
 private:
     static Difficulty difficulty;
     static std::pair <Resolution, Resolution> resolution;
+    static int levelScale;
+    Difficulty savedDiff;
+    std::pair <Resolution, Resolution> savedResolution;
+    std::pair <int, int> space = {Resolution::LW, Resolution::LH};
 public:
     Settings(); 
+    Settings(Difficulty diff, std::pair<Resolution, Resolution> res) : savedDiff(diff), savedResolution(res) {}
+    Difficulty getSavedDiff() { return savedDiff; }
+    std::pair<Resolution, Resolution> getSavedResolution() { return savedResolution; }
+    void apply();
     static Difficulty getDiff();
     void setDiff(Difficulty diff);
+    static int getLevelScale() { return levelScale; }
+    static void setLevelScale(int k) { levelScale = std::max(k, 1); }
     static std::pair<Resolution, Resolution> getResolution();
     void setResolution(std::string str);
-    void setResolution(std::pair<Resolution, Resolution> res) { resolution = res; }
+    void setResolution(std::pair<Resolution, Resolution> res) { resolution = savedResolution = res; }
+    std::pair<int, int> getSpace() { return space; }
+    void setSpace(std::pair<int, int> extent) { space = extent; }
     static std::string getDiffStr();
+    static std::string getDiffStr(Difficulty diff);
     static std::string getResolutionStr();
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Menu : public DisplayObject {
@@ -374,43 +694,134 @@ private:
     TextBlock* text;
 public:
     Menu(sf::Vector2f size, sf::Color col, std::vector<Button*> items, std::string title);
+    ~Menu() override;
+    void setTitle(std::string title);
     void draw(sf::RenderWindow &target) override;
     Button* getButton(int index);
     void update(sf::Vector2i mousePos, bool pressed);
 };
 
+class GameField;
+
+// Where platform steering comes from, asked once per tick: -1 moves left, 1 right, 0 holds still
+class InputProvider {
+public:
+    virtual ~InputProvider() = default;
+    virtual int steer(GameField* field)=0;
+};
+
+class KeyboardInput : public InputProvider {
+public:
+    int steer(GameField* field) override;
+};
+
+// Steers under the lowest ball's predicted landing point and, when the ball leaves time for it, under a falling bonus worth having
+class Autopilot : public InputProvider {
+private:
+    bool catchBonuses;
+    bool wanted(EventType bonus);
+public:
+    Autopilot(bool bonuses = true) : catchBonuses(bonuses) {}
+    int steer(GameField* field) override;
+};
+
+// One rewind point. Copy assignment reuses each buffer's capacity, so once the ring has
+// filled neither capturing nor restoring allocates
+struct FieldSnapshot {
+    long long tick;
+    std::vector<std::pair<long long, EventType>> timers;
+    MotionComponents motion;
+    std::vector<DisplayObject*> objects;
+    std::vector<MovableObject*> moveObjects;
+    std::vector<Bonus*> bonuses, released;
+    size_t spawned;
+    std::vector<bool> bricks;
+    std::vector<float> platformWidths;
+    int lives, score, catched;
+    float time;
+    EventType result;
+    std::mt19937_64 rng;
+};
+
 class GameField : public DisplayObject {
 private:
     Statistics* data;
     MessageBox* message;
-    StatusBar* board;
-    std::map<sf::Clock*, std::pair<float, EventType>> bonus_timers;
+    StatusBar* board = nullptr;
+    long long tick = 0;
+    std::vector<std::pair<long long, EventType>> bonus_timers;
+    // Timers of unversioned saves, which counted seconds; Proxy::migrate turns them into ticks
+    std::vector<std::pair<double, EventType>> legacy_timers;
     std::vector<DisplayObject*> objects;
     std::vector<MovableObject*> move_objects;
     std::vector<Ball*> balls;
     std::vector<Platform*> platforms;
     std::vector<Bonus*> bonuses;
+    std::vector<Obstacle*> obstacles;
+    // Every bonus the field was handed, dead ones included, in arrival order; the field deletes them
+    std::vector<Bonus*> spawned;
+    // Set on clones, whose balls, platforms and statistics are copies rather than a player's
+    bool ownsPlayers = false;
+    MotionComponents motion;
+    BrickGrid* grid = nullptr;
+    bool dirty = false;
+    std::vector<FieldSnapshot> snapshots;
+    int rewindTicks = 0;
+    size_t newest = 0, stored = 0;
+    bool headless = false;
+    InputProvider* input;
+    EventType result = EventType::START;
+    std::mt19937_64 random;
+    void capture();
+    void finish(EventType outcome);
     void eventHandler(Event e) override;
     void moveObjects();
     void checkCollisions();
+    void compactObjects();
+    std::vector<Obstacle*> clearItems();
 public:
     GameField();
+    ~GameField() override;
+    GameField* clone();
+    static void benchmark(int rounds);
+    EventType getResult() { return result; }
     void draw(sf::RenderWindow &target) override;
+    void rasterize(Canvas &canvas) override;
+    void scaleBound(sf::Vector2f koef) override;
     void addItem(DisplayObject *obj);
     void addItem(Ball *obj);
     void addItem(Platform *obj);
     void addItem(Statistics *obj);
     void addItem(StatusBar* obj);
-    void addTimer(std::pair<float, EventType> data) { bonus_timers[new sf::Clock()] = data; }
+    void addItem(BrickGrid* obj);
+    void addTimer(std::pair<long long, EventType> data);
+    void addLegacyTimers(const std::vector<std::pair<double, EventType>> &timers);
+    void migrateTimers();
+    void setRewind(int ticks, int depth);
+    bool rewind(int steps);
+    void snapshot(FieldSnapshot &snap);
+    // Deletes the bonuses handed over since snap, so snapshots taken after it must not be restored later
+    void restore(const FieldSnapshot &snap);
+    void reseed(uint64_t seed);
+    void addLevel();
     Statistics* getData();
-    void freezeTimers();
-    void startTimers();
     void update(sf::Vector2i mousePos, bool pressed);
     std::vector<DisplayObject*> getObjects();
+    std::vector<Obstacle*>& getObstacles() { return obstacles; }
+    std::vector<Ball*>& getBalls() { return balls; }
+    std::vector<Platform*>& getPlatforms() { return platforms; }
+    std::vector<Bonus*>& getBonuses() { return bonuses; }
+    void setInput(InputProvider* provider) { input = provider; }
+    BrickGrid* getGrid() { return grid; }
+    StatusBar* getBoard() { return board; }
+    std::vector<bool> getVisibility();
+    void to_delta(std::string &buf, std::vector<bool> &visible);
+    bool apply_delta(const char* &cur);
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Player : public SaveloadObject {
@@ -421,13 +832,15 @@ private:
 public:
     Player(std::string name);
     Player(Statistics* s, Platform* p, std::vector <Ball*> b);
+    ~Player() override;
     Platform* getPlatform();
     Statistics* getStatistics();
     std::vector <Ball*> getBalls();
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
 };
 
 class Players : public SaveloadObject {
@@ -435,49 +848,167 @@ private:
     std::vector <Player*> players;
 public:
     Players();
+    ~Players() override;
     void addPlayer(Player *player);
     std::vector <Player*> getPlayers();
     void to_string(std::stringstream &strStream) override;
-    SaveloadObject* from_string(std::stringstream &strStream) override;
-    json to_json() override;
-    SaveloadObject* from_json(json &deri) override;
+    SaveloadObject* from_string(TextReader &reader) override;
+    void to_json(JsonWriter &writer) override;
+    void to_binary(std::string &buf) override;
+    SaveloadObject* from_binary(const char* &cur) override;
+};
+
+// Many single-ball boards of one level stepped side by side, each quantity kept as one array across boards.
+// A step applies the rules the field's objects do, bonuses aside: Ball::eventHandler bounces, bricks hit
+// in the order the field checks them and the status bar as the ceiling. A finished board starts over
+class FieldBatch {
+private:
+    int boards, words;
+    std::vector<sf::FloatRect> bricks;
+    int columns;
+    sf::Vector2f origin, pitch;
+    sf::FloatRect ball, platform, ceiling;
+    sf::Vector2f launch;
+    std::vector<sf::Color> colors;
+    sf::Color ballColor, platformColor;
+    std::vector<float> ballX, ballY, velX, velY, platformX;
+    std::vector<int> lives, score, alive;
+    std::vector<uint64_t> cells, random;
+    float draw(int board);
+    void bounce(int board, bool horizontal);
+    void restart(int board);
+public:
+    FieldBatch(int n, uint64_t seed);
+    static void benchmark(int n);
+    int getBoards() { return boards; }
+    int getBricks() { return bricks.size(); }
+    int getWords() { return words; }
+    float getPlatformY() { return platform.top; }
+    float getPlatformWidth() { return platform.width; }
+    const std::vector<float>& getBallX() { return ballX; }
+    const std::vector<float>& getBallY() { return ballY; }
+    const std::vector<float>& getVelX() { return velX; }
+    const std::vector<float>& getVelY() { return velY; }
+    const std::vector<float>& getPlatformX() { return platformX; }
+    const std::vector<int>& getLives() { return lives; }
+    const std::vector<int>& getScore() { return score; }
+    const std::vector<uint64_t>& getCells() { return cells; }
+    void reset(uint64_t seed);
+    void render(int board, Canvas &canvas);
+    void step_all(const int* actions, float* rewards, int* dones);
+};
+
+class MappedFile {
+private:
+    const char* data;
+    size_t size;
+public:
+    MappedFile(const std::string &filename);
+    ~MappedFile();
+    const char* getData() { return data; }
+    size_t getSize() { return size; }
+};
+
+struct SaveJob {
+    std::string name;
+    SaveJobKind kind;
+    std::string data;
+    EventType done, failed;
+    std::string header;
+};
+
+class SaveWriter {
+private:
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::deque<SaveJob> jobs;
+    std::string busy;
+    bool stop;
+    void run();
+    bool write(const SaveJob &job);
+public:
+    SaveWriter();
+    ~SaveWriter();
+    void post(SaveJob job);
+    bool pending(const std::string &name);
+    void flush();
 };
 
 class Game;
 
 class Proxy {
+private:
+    uint32_t base = 0;
+    int deltas = 0;
+    size_t baseBytes = 0, deltaBytes = 0, limit = 0;
+    int version = SaveFormat::SF_VERSION;
+    std::vector<bool> visible;
 public:
+    int getVersion() { return version; }
+    void migrate(std::vector <SaveloadObject*> &toLoad);
     std::string to_string(std::vector <SaveloadObject*> &toSave);
-    json to_json(std::vector <SaveloadObject*> &toSave);
-    void from_string(std::vector <SaveloadObject*> &toLoad, std::stringstream &strStream);
-    void from_json(std::vector <SaveloadObject*> &toLoad, json &deri);
+    std::string dump_json(std::vector <SaveloadObject*> &toSave);
+    bool from_string(std::vector <SaveloadObject*> &toLoad, TextReader &reader);
+    bool from_json(std::vector <SaveloadObject*> &toLoad, const char* data, size_t size);
+    std::string to_binary(std::vector <SaveloadObject*> &toSave);
+    bool from_binary(std::vector <SaveloadObject*> &toLoad, const char* data, size_t size, bool verify = true);
+    std::string to_delta(std::vector <SaveloadObject*> &toSave);
+    void from_delta(std::vector <SaveloadObject*> &toLoad, const char* data, size_t size);
+    void dropDeltas() { base = 0; }
+    void setLimit(size_t bytes) { limit = bytes; }
 };
 
 class Game {
     friend class Proxy;
 private:
-    std::ifstream inFile;
-    std::ofstream outFile;
+    SaveWriter writer;
+    Proxy journal;
+    int autosaveTicks = 0, autosaveCountdown = 0;
+    int rewindTicks = Timing::REWIND_TICKS, rewindDepth = Timing::REWIND_SNAPSHOTS;
+    InputProvider* input = nullptr;
     std::vector <SaveloadObject*> toSave;
     sf::Clock timer;
     Active state;
-    Proxy* history;
-    sf::RenderWindow *window;
-    Players *sessionPlayers;
-    Menu /** *menu ,*/ *settingsMenu, *pauseMenu; // Change pausenames if all works
-    MessageBox* start, *win, *lose;
-    Settings *settings;
-    GameField *gameField;
+    Proxy* history = nullptr;
+    sf::RenderWindow *window = nullptr;
+    std::pair<Resolution, Resolution> layout;
+    Players *sessionPlayers = nullptr;
+    Menu /** *menu ,*/ *settingsMenu = nullptr, *pauseMenu = nullptr, *slotsMenu = nullptr; // Change pausenames if all works
+    int slot = 0;
+    bool savingSlot = false;
+    MessageBox* start = nullptr, *win = nullptr, *lose = nullptr;
+    Settings *settings = nullptr;
+    GameField *gameField = nullptr;
     void update();
     void eventHandler(Event e);
     void initMenus();
-    void reinit();
-    void load();
-    void load_json();
-    void save(std::vector <SaveloadObject*> toSave);
-    void save_json(std::vector <SaveloadObject*> toSave);
+    void resize();
+    void attachLoaded();
+    void load(const std::string &name);
+    void load_json(const std::string &name);
+    void load_binary(const std::string &name);
+    bool load_chain(const std::string &name);
+    void save_chain(const std::string &name, Proxy* chain, SaveJobKind full, EventType done, EventType failed, const std::string &header);
+    void readSlots();
+    void autosave();
+    void discardJournal();
+    void save(std::vector <SaveloadObject*> toSave, const std::string &name);
+    void save_json(std::vector <SaveloadObject*> toSave, const std::string &name);
+    void save_binary(std::vector <SaveloadObject*> toSave, const std::string &name);
 public:
     Game();
+    ~Game();
+    void benchmark(int rounds);
+    void setAutosave(int ticks, size_t cap);
+    void setRewind(int ticks, int depth);
+    void setInput(InputProvider* provider) { input = provider; }
+    void soak(long long ticks);
+    bool screenshot(const std::string &filename, int width, int height);
+#ifdef ARCANOID_PROFILE
+    void dumpTrace();
+#endif
+    bool recover();
     void create();
     void init();
     void process();
@@ -485,7 +1016,9 @@ public:
 
 class EventDispatcher {
 private:
-    static std::queue<Event> eventQueue, gameEventQueue;
+    static std::queue<Event> eventQueue;
+    static thread_local std::queue<Event> gameEventQueue;
+    static std::mutex mutex;
 public:
     static void setEvent(Event e);
     static bool pollEvent(Event &e);
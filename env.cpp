@@ -0,0 +1,198 @@
+#include <bits/stdc++.h>
+#include <SFML/Graphics.hpp>
+#include "classes.hpp"
+#include "env.h"
+
+class ActionInput : public InputProvider {
+public:
+    int action = 0;
+    int steer(GameField* field) override { return action; }
+};
+
+// The env owns the template level with the player and status bar it was built from, and the clone that is
+// stepped. The clone draws with the level's shapes and bounces off its status bar, so it goes first
+struct ArcanoidEnv {
+    Difficulty difficulty;
+    Player* player = nullptr;
+    StatusBar* bar = nullptr;
+    GameField* level = nullptr;
+    GameField* field = nullptr;
+    FieldSnapshot start;
+    ActionInput input;
+};
+
+static void release(ArcanoidEnv* env) {
+    delete env->field;
+    delete env->level;
+    delete env->bar;
+    delete env->player;
+    env->field = env->level = nullptr;
+    env->bar = nullptr;
+    env->player = nullptr;
+}
+
+// Lays out a level the way a new game does and keeps a headless clone of it, with its first tick as the snapshot
+// every reset goes back to. The status bar is built only to serve as the ceiling
+static void build(ArcanoidEnv* env, Difficulty diff) {
+    release(env);
+    env->level = new GameField();
+    env->player = new Player("Agent");
+    env->level->addItem(env->player->getPlatform());
+    for (Ball* ball : env->player->getBalls()) {
+        env->level->addItem(ball);
+    }
+    env->level->addItem(env->player->getStatistics());
+    env->level->addLevel();
+    env->bar = new StatusBar(sf::Vector2f(Resolution::LW, Resolution::LH / 20), env->level->getData());
+    env->level->addItem(env->bar);
+    env->field = env->level->clone();
+    env->field->setInput(&env->input);
+    env->field->snapshot(env->start);
+    env->difficulty = diff;
+}
+
+ArcanoidEnv* arcanoid_create(void) {
+    return new ArcanoidEnv();
+}
+
+void arcanoid_destroy(ArcanoidEnv* env) {
+    release(env);
+    delete env;
+}
+
+void arcanoid_reset(ArcanoidEnv* env, uint64_t seed, int difficulty) {
+    Difficulty diff = (Difficulty)std::clamp(difficulty, (int)Difficulty::DF_EASY, (int)Difficulty::DF_HARD);
+    if (Settings::getDiff() != diff) Settings().setDiff(diff);
+    if (!env->field || env->difficulty != diff) build(env, diff);
+    env->field->restore(env->start);
+    env->field->reseed(seed);
+}
+
+float arcanoid_step(ArcanoidEnv* env, int action, int* done) {
+    Statistics* stats = env->field->getData();
+    int score = stats->getScore(), lives = stats->getLives();
+    env->input.action = (action > 0) - (action < 0);
+    env->field->update(sf::Vector2i(0, 0), false);
+    if (done) *done = env->field->getResult() != EventType::START;
+    return (stats->getScore() - score) / 10 - (lives - stats->getLives());
+}
+
+int arcanoid_observation_size(ArcanoidEnv* env) {
+    BrickGrid* grid = env->field->getGrid();
+    size_t bricks = env->field->getObstacles().size() + (grid ? grid->getCells().size() : 0);
+    return ARCANOID_OBS_BRICKS + (bricks + ARCANOID_BRICKS_PER_FLOAT - 1) / ARCANOID_BRICKS_PER_FLOAT;
+}
+
+void arcanoid_observe(ArcanoidEnv* env, float* buffer) {
+    GameField* field = env->field;
+    Ball* ball = field->getBalls()[0];
+    sf::FloatRect box = ball->getBound();
+    sf::Vector2f velocity = ball->getVelocity();
+    buffer[ARCANOID_OBS_BALL] = box.left;
+    buffer[ARCANOID_OBS_BALL + 1] = box.top;
+    buffer[ARCANOID_OBS_BALL + 2] = velocity.x;
+    buffer[ARCANOID_OBS_BALL + 3] = velocity.y;
+    box = field->getPlatforms()[0]->getBound();
+    buffer[ARCANOID_OBS_PLATFORM] = box.left;
+    buffer[ARCANOID_OBS_PLATFORM + 1] = box.top;
+    buffer[ARCANOID_OBS_PLATFORM + 2] = box.width;
+    buffer[ARCANOID_OBS_LIVES] = field->getData()->getLives();
+    float* slot = buffer + ARCANOID_OBS_BONUSES;
+    for (Bonus* bonus : field->getBonuses()) {
+        if (!bonus->isVisible() || slot == buffer + ARCANOID_OBS_BRICKS) continue;
+        box = bonus->getBound();
+        slot[0] = box.left;
+        slot[1] = box.top;
+        slot[2] = bonus->getBonus() - EventType::NO_BONUS;
+        slot[3] = 1;
+        slot += 4;
+    }
+    std::fill(slot, buffer + ARCANOID_OBS_BRICKS, 0.0f);
+    float* bits = buffer + ARCANOID_OBS_BRICKS;
+    uint32_t word = 0;
+    int filled = 0;
+    auto push = [&](bool alive) {
+        word |= (uint32_t)alive << filled;
+        if (++filled < ARCANOID_BRICKS_PER_FLOAT) return;
+        *bits++ = word;
+        word = 0;
+        filled = 0;
+    };
+    for (Obstacle* obstacle : field->getObstacles()) {
+        push(obstacle->isVisible());
+    }
+    if (field->getGrid()) {
+        for (uint8_t cell : field->getGrid()->getCells()) {
+            push(cell & BrickCell::BC_ALIVE);
+        }
+    }
+    if (filled) *bits = word;
+}
+
+int arcanoid_render(ArcanoidEnv* env, uint8_t* buffer, int width, int height, int channels) {
+    if (!Canvas::fits(width, height, channels)) return -1;
+    Canvas canvas(buffer, width, height, channels);
+    env->field->rasterize(canvas);
+    return 0;
+}
+
+struct ArcanoidBatch {
+    FieldBatch* boards;
+};
+
+ArcanoidBatch* arcanoid_batch_create(int boards, int difficulty, uint64_t seed) {
+    Difficulty diff = (Difficulty)std::clamp(difficulty, (int)Difficulty::DF_EASY, (int)Difficulty::DF_HARD);
+    if (Settings::getDiff() != diff) Settings().setDiff(diff);
+    return new ArcanoidBatch{new FieldBatch(boards, seed)};
+}
+
+void arcanoid_batch_destroy(ArcanoidBatch* batch) {
+    delete batch->boards;
+    delete batch;
+}
+
+void arcanoid_batch_reset(ArcanoidBatch* batch, uint64_t seed) {
+    batch->boards->reset(seed);
+}
+
+void arcanoid_batch_step_all(ArcanoidBatch* batch, const int* actions, float* rewards, int* dones) {
+    batch->boards->step_all(actions, rewards, dones);
+}
+
+int arcanoid_batch_observation_size(ArcanoidBatch* batch) {
+    return ARCANOID_OBS_BRICKS + (batch->boards->getBricks() + ARCANOID_BRICKS_PER_FLOAT - 1) / ARCANOID_BRICKS_PER_FLOAT;
+}
+
+void arcanoid_batch_observe(ArcanoidBatch* batch, float* buffer) {
+    FieldBatch* boards = batch->boards;
+    int size = arcanoid_batch_observation_size(batch), bricks = boards->getBricks(), words = boards->getWords();
+    for (int i = 0; i < boards->getBoards(); ++i, buffer += size) {
+        buffer[ARCANOID_OBS_BALL] = boards->getBallX()[i];
+        buffer[ARCANOID_OBS_BALL + 1] = boards->getBallY()[i];
+        buffer[ARCANOID_OBS_BALL + 2] = boards->getVelX()[i];
+        buffer[ARCANOID_OBS_BALL + 3] = boards->getVelY()[i];
+        buffer[ARCANOID_OBS_PLATFORM] = boards->getPlatformX()[i];
+        buffer[ARCANOID_OBS_PLATFORM + 1] = boards->getPlatformY();
+        buffer[ARCANOID_OBS_PLATFORM + 2] = boards->getPlatformWidth();
+        buffer[ARCANOID_OBS_LIVES] = boards->getLives()[i];
+        std::fill(buffer + ARCANOID_OBS_BONUSES, buffer + ARCANOID_OBS_BRICKS, 0.0f);
+        const uint64_t* cells = boards->getCells().data() + (size_t)i * words;
+        for (int k = 0; k < bricks; k += ARCANOID_BRICKS_PER_FLOAT) {
+            uint32_t word = 0;
+            for (int j = k; j < std::min(bricks, k + ARCANOID_BRICKS_PER_FLOAT); ++j) {
+                word |= (uint32_t)(cells[j / 64] >> (j % 64) & 1) << (j - k);
+            }
+            buffer[ARCANOID_OBS_BRICKS + k / ARCANOID_BRICKS_PER_FLOAT] = word;
+        }
+    }
+}
+
+int arcanoid_batch_render(ArcanoidBatch* batch, uint8_t* buffer, int width, int height, int channels) {
+    if (!Canvas::fits(width, height, channels)) return -1;
+    size_t frame = (size_t)width * height * channels;
+    for (int i = 0; i < batch->boards->getBoards(); ++i) {
+        Canvas canvas(buffer + i * frame, width, height, channels);
+        batch->boards->render(i, canvas);
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef ARCANOID_ENV_H
+#define ARCANOID_ENV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Windowless game for external agents, built with classes.cpp into a shared library. Difficulty is
+// process-wide, so environments stepped side by side have to be reset with the same one; otherwise each
+// environment may be stepped on its own thread
+
+// Observation layout, in floats: the ball and platform in logical units, the falling bonuses as
+// x, y, type (EventType - 100) and 1 for a present slot, then the bricks as a bitset of 24 per float
+enum ArcanoidObservation {
+    ARCANOID_OBS_BALL = 0,
+    ARCANOID_OBS_PLATFORM = 4,
+    ARCANOID_OBS_LIVES = 7,
+    ARCANOID_OBS_BONUSES = 8,
+    ARCANOID_BONUS_SLOTS = 8,
+    ARCANOID_OBS_BRICKS = ARCANOID_OBS_BONUSES + ARCANOID_BONUS_SLOTS * 4,
+    ARCANOID_BRICKS_PER_FLOAT = 24,
+};
+
+typedef struct ArcanoidEnv ArcanoidEnv;
+
+ArcanoidEnv* arcanoid_create(void);
+void arcanoid_destroy(ArcanoidEnv* env);
+// Difficulty runs from 1 (easy) to 5 (hard); the level is built on the first reset at a difficulty and reused after
+void arcanoid_reset(ArcanoidEnv* env, uint64_t seed, int difficulty);
+// Action -1 steers left, 1 right, 0 holds; the reward is one per brick broken less one per life lost
+float arcanoid_step(ArcanoidEnv* env, int action, int* done);
+int arcanoid_observation_size(ArcanoidEnv* env);
+void arcanoid_observe(ArcanoidEnv* env, float* buffer);
+// Draws the field into width x height pixels of 1 (gray) or 4 (RGBA) channels, row by row. Returns 0, or -1
+// without touching the buffer when the size is not positive or channels is neither 1 nor 4
+int arcanoid_render(ArcanoidEnv* env, uint8_t* buffer, int width, int height, int channels);
+
+// Many boards stepped in lockstep on flat arrays, without bonuses. A board that ends is reported done and
+// starts over from its next step. Arrays hold one entry per board and observations are laid out as above,
+// back to back, with the bonus slots always empty
+typedef struct ArcanoidBatch ArcanoidBatch;
+
+ArcanoidBatch* arcanoid_batch_create(int boards, int difficulty, uint64_t seed);
+void arcanoid_batch_destroy(ArcanoidBatch* batch);
+void arcanoid_batch_reset(ArcanoidBatch* batch, uint64_t seed);
+void arcanoid_batch_step_all(ArcanoidBatch* batch, const int* actions, float* rewards, int* dones);
+int arcanoid_batch_observation_size(ArcanoidBatch* batch);
+void arcanoid_batch_observe(ArcanoidBatch* batch, float* buffer);
+// One frame per board, back to back; returns as arcanoid_render does
+int arcanoid_batch_render(ArcanoidBatch* batch, uint8_t* buffer, int width, int height, int channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,10 +6,56 @@
 
 using json = nlohmann::json;
 
-int main() {
-    Game *game = new Game();;
+int main(int argc, char** argv) {
+    std::unique_ptr<InputProvider> autopilot;
+    std::unique_ptr<Game> game(new Game());
+#ifdef ARCANOID_PROFILE
+    signal(SIGUSR1, [](int) { Profiler::request(); });
+#endif
+    if (argc > 2 && std::string(argv[1]) == "--bench-save") {
+        game->benchmark(std::stoi(argv[2]));
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--bench-render") {
+        Canvas::benchmark(std::stoi(argv[2]));
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--bench-batch") {
+        FieldBatch::benchmark(std::stoi(argv[2]));
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--bench-clone") {
+        GameField::benchmark(std::stoi(argv[2]));
+        return 0;
+    }
+    int autosaveTicks = Timing::AUTOSAVE_TICKS;
+    size_t journalCap = SaveFormat::SF_JOURNAL_CAP;
+    int rewindTicks = Timing::REWIND_TICKS, rewindDepth = Timing::REWIND_SNAPSHOTS;
+    long long soakTicks = 0;
+    std::string screenshot;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::string(argv[i]) == "--autosave") autosaveTicks = std::stof(argv[i + 1]) * 1000000 / Timing::TICK_USEC;
+        if (std::string(argv[i]) == "--journal-cap") journalCap = std::stoul(argv[i + 1]);
+        if (std::string(argv[i]) == "--rewind") rewindTicks = std::stof(argv[i + 1]) * 1000000 / Timing::TICK_USEC;
+        if (std::string(argv[i]) == "--rewind-depth") rewindDepth = std::stoi(argv[i + 1]);
+        if (std::string(argv[i]) == "--autopilot") {
+            autopilot.reset(new Autopilot(std::string(argv[i + 1]) != "ball"));
+            game->setInput(autopilot.get());
+        }
+        if (std::string(argv[i]) == "--soak") soakTicks = std::stoll(argv[i + 1]);
+        if (std::string(argv[i]) == "--screenshot") screenshot = argv[i + 1];
+        if (std::string(argv[i]) == "--level-scale") Settings::setLevelScale(std::stoi(argv[i + 1]));
+    }
+    game->setAutosave(autosaveTicks, journalCap);
+    game->setRewind(rewindTicks, rewindDepth);
+    if (soakTicks) {
+        game->soak(soakTicks);
+        if (!screenshot.empty() && !game->screenshot(screenshot, Resolution::LW / 2, Resolution::LH / 2)) std::cout << "Could not write " << screenshot << '\n';
+        return 0;
+    }
     game->create();
     game->init();
+    game->recover();
     game->process();
     return 0;
 }
\ No newline at end of file
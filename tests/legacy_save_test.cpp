@@ -0,0 +1,45 @@
+// Built by hand like main.cpp: g++ -std=c++17 tests/legacy_save_test.cpp classes.cpp -I. -lsfml-graphics -lsfml-window -lsfml-system
+// Run from the repository root, or pass the fixtures directory
+#include <bits/stdc++.h>
+#include <SFML/Graphics.hpp>
+#include "classes.hpp"
+
+static std::string readFile(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// Unversioned saves kept a pending bonus as seconds left; 4.5 s is 281 ticks of 16 ms
+static bool check(const std::string &filename, bool json) {
+    std::vector<SaveloadObject*> toLoad = {new Settings(), new Players(), new GameField()};
+    std::vector<SaveloadObject*> blank = toLoad;
+    std::string data = readFile(filename);
+    Proxy proxy;
+    bool loaded;
+    if (json) {
+        loaded = proxy.from_json(toLoad, data.data(), data.size());
+    } else {
+        TextReader reader(data.data(), data.size());
+        loaded = proxy.from_string(toLoad, reader);
+        if (!loaded) std::cout << filename << ": " << reader.error() << '\n';
+    }
+    std::stringstream field;
+    if (loaded) {
+        proxy.migrate(toLoad);
+        toLoad[SaveSectionId::SS_FIELD]->to_string(field);
+    }
+    bool ok = loaded && proxy.getVersion() == SaveFormat::SF_VERSION && field.str().find("\tTimersNum 1\n\tTimer\n\t\tTicksLeft 281\n\t\tEvent 33\n") != std::string::npos;
+    std::cout << filename << (ok ? ": ok\n" : ": FAILED\n");
+    for (int i = 0; i < toLoad.size(); ++i) {
+        if (toLoad[i] != blank[i]) delete toLoad[i];
+        delete blank[i];
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : "tests/fixtures";
+    bool ok = check(dir + "/legacy_timer.txt", false);
+    ok = check(dir + "/legacy_timer.json", true) && ok;
+    return ok ? 0 : 1;
+}
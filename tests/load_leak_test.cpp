@@ -0,0 +1,63 @@
+// Built by hand like main.cpp: g++ -std=c++17 tests/load_leak_test.cpp classes.cpp -I. -lsfml-graphics -lsfml-window -lsfml-system
+#include <bits/stdc++.h>
+#include <SFML/Graphics.hpp>
+#include "classes.hpp"
+
+static std::atomic<long long> live{0};
+
+void* operator new(size_t size) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    live++;
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    live--;
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// Loading the same journal over and over must not keep any allocation alive
+int main() {
+    {
+        Settings settings;
+        Players players;
+        players.addPlayer(new Player("Leak"));
+        GameField field;
+        for (Player* player : players.getPlayers()) {
+            field.addItem(player->getPlatform());
+            for (Ball* ball : player->getBalls()) {
+                field.addItem(ball);
+            }
+            field.addItem(player->getStatistics());
+        }
+        field.addLevel();
+        std::vector<SaveloadObject*> toSave = {&settings, &players, &field};
+        Proxy journal;
+        std::ofstream("leak.bin", std::ios::binary) << journal.to_binary(toSave);
+        std::ofstream deltas("leak.delta", std::ios::binary);
+        for (int i = 0; i < 3; ++i) {
+            for (int k = 0; k < 60; ++k) field.update(sf::Vector2i(0, 0), false);
+            deltas << journal.to_delta(toSave);
+        }
+    }
+    rename("leak.bin", "autosave.bin");
+    rename("leak.delta", "autosave.delta");
+    Game* game = new Game();
+    game->init();
+    bool ok = game->recover() && game->recover();
+    long long before = live;
+    for (int i = 0; i < 50; ++i) {
+        ok = ok && game->recover();
+    }
+    long long grown = live - before;
+    unlink("autosave.bin");
+    unlink("autosave.delta");
+    std::cout << "load leak: " << grown << " allocations over 50 loads" << (ok && !grown ? ", ok\n" : ", FAILED\n");
+    return ok && !grown ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+// Built by hand like main.cpp: g++ -std=c++17 tests/motion_test.cpp classes.cpp -I. -lsfml-graphics -lsfml-window -lsfml-system
+#include <bits/stdc++.h>
+#include <SFML/Graphics.hpp>
+#include "classes.hpp"
+
+// Attaching to the store an object already lives in keeps its one slot
+int main() {
+    MotionComponents store;
+    Ball first(10, sf::Vector2f(100, 200), sf::Color::White, sf::Vector2f(3, 4));
+    Ball second(10, sf::Vector2f(300, 400), sf::Color::White, sf::Vector2f(-5, 6));
+    first.attach(&store);
+    second.attach(&store);
+    first.attach(&store);
+    second.attach(&store);
+    bool ok = store.bounds.size() == 2 && store.owners[0] == &first && store.owners[1] == &second;
+    ok = ok && first.getBound().left == 100 && first.getVelocity() == sf::Vector2f(3, 4);
+    ok = ok && second.getBound().left == 300 && second.getVelocity() == sf::Vector2f(-5, 6);
+    first.detach();
+    ok = ok && store.bounds.size() == 1 && store.owners[0] == &second && second.getBound().left == 300;
+    std::cout << (ok ? "motion: ok\n" : "motion: FAILED\n");
+    return ok ? 0 : 1;
+}